@@ -1,9 +1,24 @@
 #include "devices/block.h"
+#include <debug.h>
 #include <list.h>
+#include <round.h>
 #include <string.h>
 #include <stdio.h>
 #include "devices/ide.h"
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Number of latency histogram buckets.  Bucket I counts requests
+   that took from 2**I to 2**(I+1) - 1 cycles; the last bucket
+   also counts anything slower. */
+#define LATENCY_BUCKETS 40
+
+/* Most pages of bounce buffer used to stage a transfer to or
+   from user memory. */
+#define BOUNCE_PAGES 16
 
 /* A block device. */
 struct block
@@ -19,6 +34,15 @@ struct block
 
     unsigned long long read_cnt;        /* Number of sectors read. */
     unsigned long long write_cnt;       /* Number of sectors written. */
+    unsigned long long read_req_cnt;    /* Number of read requests. */
+    unsigned long long write_req_cnt;   /* Number of write requests. */
+
+    /* Request latencies, submit to completion, in cycles. */
+    unsigned long long read_latency[LATENCY_BUCKETS];
+    unsigned long long write_latency[LATENCY_BUCKETS];
+
+    int in_flight;                      /* Requests being carried out. */
+    int peak_in_flight;                 /* Most requests in flight. */
   };
 
 /* List of all block devices. */
@@ -28,6 +52,15 @@ static struct list all_blocks = LIST_INITIALIZER (all_blocks);
 static struct block *block_by_role[BLOCK_ROLE_CNT];
 
 static struct block *list_elem_to_block (struct list_elem *);
+static void transfer (struct block *, block_sector_t, block_sector_t cnt,
+                      void *, bool write);
+static void bounce_transfer (struct block *, block_sector_t,
+                             block_sector_t cnt, void *, bool write);
+static void driver_transfer (struct block *, block_sector_t,
+                             block_sector_t cnt, void *, bool write);
+static uint64_t start_request (struct block *);
+static void end_request (struct block *, uint64_t start, bool write,
+                         block_sector_t cnt);
 
 /* Returns a human-readable name for the given block device
    TYPE. */
@@ -121,8 +154,7 @@ void
 block_read (struct block *block, block_sector_t sector, void *buffer)
 {
   check_sector (block, sector);
-  block->ops->read (block->aux, sector, buffer);
-  block->read_cnt++;
+  transfer (block, sector, 1, buffer, false);
 }
 
 /* Write sector SECTOR to BLOCK from BUFFER, which must contain
@@ -135,8 +167,150 @@ block_write (struct block *block, block_sector_t sector, const void *buffer)
 {
   check_sector (block, sector);
   ASSERT (block->type != BLOCK_FOREIGN);
-  block->ops->write (block->aux, sector, buffer);
-  block->write_cnt++;
+  transfer (block, sector, 1, (void *) buffer, true);
+}
+
+/* Verifies that the CNT sectors starting at SECTOR are all
+   within BLOCK.  Panics if not. */
+static void
+check_range (struct block *block, block_sector_t sector, block_sector_t cnt)
+{
+  check_sector (block, sector);
+  if (cnt > block->size - sector)
+    PANIC ("Access past end of device %s (sector=%"PRDSNu", cnt=%"PRDSNu", "
+           "size=%"PRDSNu")\n", block_name (block), sector, cnt, block->size);
+}
+
+/* Reads CNT consecutive sectors starting at SECTOR from BLOCK
+   into BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes.  The driver transfers them in as few requests as it
+   can, which is much faster than reading them one at a time.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void
+block_read_multiple (struct block *block, block_sector_t sector,
+                     block_sector_t cnt, void *buffer)
+{
+  if (cnt == 0)
+    return;
+  check_range (block, sector, cnt);
+  transfer (block, sector, cnt, buffer, false);
+}
+
+/* Writes CNT consecutive sectors starting at SECTOR to BLOCK
+   from BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes,
+   as block_read_multiple() does for reads.  Returns after the
+   block device has acknowledged receiving the data. */
+void
+block_write_multiple (struct block *block, block_sector_t sector,
+                      block_sector_t cnt, const void *buffer)
+{
+  if (cnt == 0)
+    return;
+  check_range (block, sector, cnt);
+  ASSERT (block->type != BLOCK_FOREIGN);
+  transfer (block, sector, cnt, (void *) buffer, true);
+}
+
+/* Transfers CNT sectors starting at SECTOR between BLOCK and
+   BUFFER, writing to BLOCK if WRITE is true and reading from it
+   otherwise, and records the request in BLOCK's statistics. */
+static void
+transfer (struct block *block, block_sector_t sector, block_sector_t cnt,
+          void *buffer, bool write)
+{
+  uint64_t start = start_request (block);
+
+  if (is_user_vaddr (buffer))
+    bounce_transfer (block, sector, cnt, buffer, write);
+  else
+    driver_transfer (block, sector, cnt, buffer, write);
+  end_request (block, start, write, cnt);
+}
+
+/* Transfers CNT sectors as transfer() does, for a BUFFER in user
+   memory.
+
+   Drivers may carry out requests in threads of their own, such
+   as the IDE dispatchers and the RAID-0 workers, which run with
+   only the kernel's page directory, so they cannot reach BUFFER.
+   Instead, the transfer is staged through kernel bounce pages,
+   which are copied to or from BUFFER here, in the caller's
+   context, where BUFFER is mapped.  Kept out of line so that its
+   sector buffer does not take up stack in every transfer. */
+static void NO_INLINE
+bounce_transfer (struct block *block, block_sector_t sector,
+                 block_sector_t cnt, void *buffer, bool write)
+{
+  size_t page_cnt = DIV_ROUND_UP (cnt * BLOCK_SECTOR_SIZE, PGSIZE);
+  uint8_t sector_buf[BLOCK_SECTOR_SIZE];
+  uint8_t *p = buffer;
+  uint8_t *bounce;
+  block_sector_t bounce_cnt;
+
+  /* Take as much of the transfer at a time as memory allows, or
+     failing that, one sector at a time. */
+  if (page_cnt > BOUNCE_PAGES)
+    page_cnt = BOUNCE_PAGES;
+  bounce = palloc_get_multiple (0, page_cnt);
+  while (bounce == NULL && page_cnt > 1)
+    {
+      page_cnt /= 2;
+      bounce = palloc_get_multiple (0, page_cnt);
+    }
+  bounce_cnt = page_cnt * PGSIZE / BLOCK_SECTOR_SIZE;
+  if (bounce == NULL)
+    {
+      bounce = sector_buf;
+      bounce_cnt = 1;
+    }
+
+  while (cnt > 0)
+    {
+      block_sector_t n = cnt < bounce_cnt ? cnt : bounce_cnt;
+      size_t size = n * BLOCK_SECTOR_SIZE;
+
+      if (write)
+        memcpy (bounce, p, size);
+      driver_transfer (block, sector, n, bounce, write);
+      if (!write)
+        memcpy (p, bounce, size);
+      p += size;
+      sector += n;
+      cnt -= n;
+    }
+
+  if (bounce != sector_buf)
+    palloc_free_multiple (bounce, page_cnt);
+}
+
+/* Has BLOCK's driver transfer CNT sectors starting at SECTOR
+   between BLOCK and BUFFER, in one request if the driver
+   supports multi-sector requests and one per sector otherwise. */
+static void
+driver_transfer (struct block *block, block_sector_t sector,
+                 block_sector_t cnt, void *buffer, bool write)
+{
+  const struct block_operations *ops = block->ops;
+  uint8_t *p = buffer;
+  block_sector_t i;
+
+  if (write)
+    {
+      if (cnt > 1 && ops->write_multiple != NULL)
+        ops->write_multiple (block->aux, sector, cnt, buffer);
+      else
+        for (i = 0; i < cnt; i++)
+          ops->write (block->aux, sector + i, p + i * BLOCK_SECTOR_SIZE);
+    }
+  else
+    {
+      if (cnt > 1 && ops->read_multiple != NULL)
+        ops->read_multiple (block->aux, sector, cnt, buffer);
+      else
+        for (i = 0; i < cnt; i++)
+          ops->read (block->aux, sector + i, p + i * BLOCK_SECTOR_SIZE);
+    }
 }
 
 /* Returns the number of sectors in BLOCK. */
@@ -160,6 +334,88 @@ block_type (struct block *block)
   return block->type;
 }
 
+/* Notes that a request to BLOCK is starting.  Returns the
+   current time, to be passed to end_request(). */
+static uint64_t
+start_request (struct block *block)
+{
+  enum intr_level old_level = intr_disable ();
+  if (++block->in_flight > block->peak_in_flight)
+    block->peak_in_flight = block->in_flight;
+  intr_set_level (old_level);
+  return rdtsc ();
+}
+
+/* Notes that a request to BLOCK for CNT sectors, a write if
+   WRITE is true and a read otherwise, that started at time START
+   has completed. */
+static void
+end_request (struct block *block, uint64_t start, bool write,
+             block_sector_t cnt)
+{
+  uint64_t cycles = rdtsc () - start;
+  enum intr_level old_level;
+  int bucket = 0;
+
+  while (bucket < LATENCY_BUCKETS - 1 && cycles >> (bucket + 1) != 0)
+    bucket++;
+
+  old_level = intr_disable ();
+  block->in_flight--;
+  if (write)
+    {
+      block->write_cnt += cnt;
+      block->write_req_cnt++;
+      block->write_latency[bucket]++;
+    }
+  else
+    {
+      block->read_cnt += cnt;
+      block->read_req_cnt++;
+      block->read_latency[bucket]++;
+    }
+  intr_set_level (old_level);
+}
+
+/* Prints the nonempty buckets of latency histogram HIST, labeled
+   with NAME, if it has any. */
+static void
+print_latency (const char *name, const unsigned long long hist[])
+{
+  bool empty = true;
+  int i;
+
+  for (i = 0; i < LATENCY_BUCKETS; i++)
+    if (hist[i] != 0)
+      {
+        if (empty)
+          printf ("  %s latency (cycles):", name);
+        empty = false;
+        printf (" 2^%d:%llu", i, hist[i]);
+      }
+  if (!empty)
+    printf ("\n");
+}
+
+/* Prints BLOCK's statistics: requests, bytes transferred, queue
+   depth and latency histograms. */
+static void
+print_block_stats (struct block *block)
+{
+  printf ("%s (%s): %llu reads in %llu requests, "
+          "%llu writes in %llu requests\n",
+          block->name, block_type_name (block->type),
+          block->read_cnt, block->read_req_cnt,
+          block->write_cnt, block->write_req_cnt);
+  printf ("  %llu bytes read, %llu bytes written, "
+          "%d in flight, peak %d\n",
+          block->read_cnt * BLOCK_SECTOR_SIZE,
+          block->write_cnt * BLOCK_SECTOR_SIZE,
+          block->in_flight, block->peak_in_flight);
+  print_latency ("read", block->read_latency);
+  print_latency ("write", block->write_latency);
+}
+
 /* Prints statistics for each block device used for a Pintos role. */
 void
 block_print_stats (void)
@@ -170,14 +426,22 @@ block_print_stats (void)
     {
       struct block *block = block_by_role[i];
       if (block != NULL)
-        {
-          printf ("%s (%s): %llu reads, %llu writes\n",
-                  block->name, block_type_name (block->type),
-                  block->read_cnt, block->write_cnt);
-        }
+        print_block_stats (block);
     }
 }
 
+/* Prints statistics, including latency histograms, for every
+   block device that has carried out any requests. */
+void
+block_print_iostat (void)
+{
+  struct block *block;
+
+  for (block = block_first (); block != NULL; block = block_next (block))
+    if (block->read_req_cnt + block->write_req_cnt > 0)
+      print_block_stats (block);
+}
+
 /* Registers a new block device with the given NAME.  If
    EXTRA_INFO is non-null, it is printed as part of a user
    message.  The block device's SIZE in sectors and its TYPE must
@@ -200,6 +464,12 @@ block_register (const char *name, enum block_type type,
   block->aux = aux;
   block->read_cnt = 0;
   block->write_cnt = 0;
+  block->read_req_cnt = 0;
+  block->write_req_cnt = 0;
+  memset (block->read_latency, 0, sizeof block->read_latency);
+  memset (block->write_latency, 0, sizeof block->write_latency);
+  block->in_flight = 0;
+  block->peak_in_flight = 0;
 
   printf ("%s: %'"PRDSNu" sectors (", block->name, block->size);
   print_human_readable_size ((uint64_t) block->size * BLOCK_SECTOR_SIZE);
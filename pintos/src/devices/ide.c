@@ -3,15 +3,32 @@
 #include <debug.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include "devices/block.h"
 #include "devices/partition.h"
+#include "devices/pci.h"
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
 
 /* The code in this file is an interface to an ATA (IDE)
-   controller.  It attempts to comply to [ATA-3]. */
+   controller.  It attempts to comply to [ATA-3].
+
+   If a PCI IDE controller with bus master support, like the
+   Intel PIIX that QEMU and Bochs emulate, is present, data is
+   transferred by DMA.  Otherwise, or if DMA fails, it is copied
+   through the data register in PIO mode.
+
+   A channel runs one command at a time for both of its disks.
+   Threads do not issue commands themselves: they queue requests
+   on the channel and sleep until the channel's dispatcher thread
+   has carried them out.  The dispatcher serves the queue in
+   C-LOOK order, sweeping upward through the pending requests'
+   sectors, then jumping back to the lowest one, and starts each
+   request as soon as the previous one completes. */
 
 /* ATA command block port addresses. */
 #define reg_data(CHANNEL) ((CHANNEL)->reg_base + 0)     /* Data. */
@@ -30,10 +47,24 @@
 #define reg_ctl(CHANNEL) ((CHANNEL)->reg_base + 0x206)  /* Control (w/o). */
 #define reg_alt_status(CHANNEL) reg_ctl (CHANNEL)       /* Alt Status (r/o). */
 
+/* Bus master IDE register port addresses.  See [SFF-8038i]. */
+#define reg_bm_command(CHANNEL) ((CHANNEL)->bm_base + 0) /* Command. */
+#define reg_bm_status(CHANNEL) ((CHANNEL)->bm_base + 2)  /* Status. */
+#define reg_bm_prdt(CHANNEL) ((CHANNEL)->bm_base + 4)    /* PRD table. */
+
+/* Bus master Command Register bits. */
+#define BM_CMD_START 0x01       /* Start transfer. */
+#define BM_CMD_READ 0x08        /* Transfer from disk to memory. */
+
+/* Bus master Status Register bits. */
+#define BM_STA_ERR 0x02         /* Error, write 1 to clear. */
+#define BM_STA_INTR 0x04        /* Interrupt, write 1 to clear. */
+
 /* Alternate Status Register bits. */
 #define STA_BSY 0x80            /* Busy. */
 #define STA_DRDY 0x40           /* Device Ready. */
 #define STA_DRQ 0x08            /* Data Request. */
+#define STA_ERR 0x01            /* Error. */
 
 /* Control Register bits. */
 #define CTL_SRST 0x04           /* Software Reset. */
@@ -49,6 +80,15 @@
 #define CMD_IDENTIFY_DEVICE 0xec        /* IDENTIFY DEVICE. */
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
+#define CMD_READ_MULTIPLE 0xc4          /* READ MULTIPLE. */
+#define CMD_WRITE_MULTIPLE 0xc5         /* WRITE MULTIPLE. */
+#define CMD_SET_MULTIPLE_MODE 0xc6      /* SET MULTIPLE MODE. */
+#define CMD_READ_DMA 0xc8               /* READ DMA. */
+#define CMD_WRITE_DMA 0xca              /* WRITE DMA. */
+
+/* Most sectors that one command can transfer: a sector count
+   register value of 0 means 256. */
+#define MAX_XFER_SECTORS 256
 
 /* An ATA device. */
 struct ata_disk
@@ -57,8 +97,28 @@ struct ata_disk
     struct channel *channel;    /* Channel that disk is attached to. */
     int dev_no;                 /* Device 0 or 1 for master or slave. */
     bool is_ata;                /* Is device an ATA disk? */
+    int multiple_cnt;           /* Sectors per READ/WRITE MULTIPLE
+                                   interrupt, or 0 if not supported. */
+    bool use_dma;               /* Transfer data by DMA? */
+  };
+
+/* A physical region descriptor, which describes one physically
+   contiguous piece of a DMA transfer's buffer.  The region may
+   not cross a 64 kB boundary. */
+struct prd
+  {
+    uint32_t addr;              /* Physical address. */
+    uint16_t size;              /* Size in bytes, 0 meaning 64 kB. */
+    uint16_t flags;             /* PRD_EOT on the last descriptor. */
   };
 
+/* Marks the last descriptor in a PRD table. */
+#define PRD_EOT 0x8000
+
+/* Descriptors in a PRD table.  A transfer of MAX_XFER_SECTORS
+   sectors, 128 kB, spans at most 3 regions of 64 kB. */
+#define PRD_CNT 8
+
 /* An ATA channel (aka controller).
    Each channel can control up to two disks. */
 struct channel
@@ -67,45 +127,101 @@ struct channel
     uint16_t reg_base;          /* Base I/O port. */
     uint8_t irq;                /* Interrupt in use. */
 
-    struct lock lock;           /* Must acquire to access the controller. */
+    struct lock lock;           /* Protects queue and statistics. */
+    struct list queue;          /* Pending requests, sorted by position. */
+    struct condition queue_nonempty;    /* Signaled when queue grows. */
+    uint64_t head_pos;          /* Position just past the last request. */
     bool expecting_interrupt;   /* True if an interrupt is expected, false if
                                    any interrupt would be spurious. */
     struct semaphore completion_wait;   /* Up'd by interrupt handler. */
+    uint16_t bm_base;           /* Bus master I/O base, 0 if none. */
+    struct prd *prdt;           /* PRD table for DMA. */
 
     struct ata_disk devices[2];     /* The devices on this channel. */
+
+    /* Statistics. */
+    unsigned long long request_cnt;     /* Requests carried out. */
+    unsigned long long travel;          /* Sum of distances between
+                                           consecutive requests. */
+    unsigned long long fifo_travel;     /* Same, in arrival order. */
+    uint64_t fifo_pos;                  /* Just past the last arrival. */
+    size_t queue_len;                   /* Current queue length. */
+    size_t peak_queue_len;              /* Longest queue seen. */
+    int64_t max_latency;                /* Longest request, in ticks. */
+    int64_t max_service;                /* Longest transfer, in ticks. */
+  };
+
+/* A request to transfer data to or from a disk, queued on the
+   disk's channel until its dispatcher carries it out. */
+struct ide_request
+  {
+    struct list_elem elem;      /* Element in channel's queue. */
+    struct ata_disk *disk;      /* Disk to access. */
+    block_sector_t sec_no;      /* First sector. */
+    block_sector_t cnt;         /* Number of sectors. */
+    void *buffer;               /* Data, CNT * BLOCK_SECTOR_SIZE bytes. */
+    bool write;                 /* True to write, false to read. */
+    int64_t start;              /* Timer tick when queued. */
+    struct semaphore done;      /* Up'd when the transfer is done. */
   };
 
 /* We support the two "legacy" ATA channels found in a standard PC. */
 #define CHANNEL_CNT 2
 static struct channel channels[CHANNEL_CNT];
 
+/* PRD table for each channel.  The alignment keeps a table from
+   crossing a 64 kB boundary, as required. */
+static struct prd prd_tables[CHANNEL_CNT][PRD_CNT]
+  __attribute__ ((aligned (sizeof (struct prd) * PRD_CNT)));
+
+/* Force PIO transfers even if DMA is available.
+   Controlled by kernel command-line option "-nodma". */
+bool ide_dma_disabled;
+
+/* Statistics. */
+static unsigned long long dma_sector_cnt;       /* Sectors moved by DMA. */
+static unsigned long long pio_sector_cnt;       /* Sectors moved by PIO. */
+
 static struct block_operations ide_operations;
 
+static uint16_t find_bus_master (void);
 static void reset_channel (struct channel *);
 static bool check_device_type (struct ata_disk *);
 static void identify_ata_device (struct ata_disk *);
+static void set_multiple_mode (struct ata_disk *, int cnt);
 
-static void select_sector (struct ata_disk *, block_sector_t);
+static void select_sector (struct ata_disk *, block_sector_t, size_t cnt);
 static void issue_pio_command (struct channel *, uint8_t command);
-static void input_sector (struct channel *, void *);
-static void output_sector (struct channel *, const void *);
+static void input_sectors (struct channel *, void *, size_t cnt);
+static void output_sectors (struct channel *, const void *, size_t cnt);
+static void pio_read (struct ata_disk *, block_sector_t, size_t cnt, void *);
+static void pio_write (struct ata_disk *, block_sector_t, size_t cnt,
+                       const void *);
+static bool dma_transfer (struct ata_disk *, block_sector_t, size_t cnt,
+                          void *, bool write);
 
 static void wait_until_idle (const struct ata_disk *);
 static bool wait_while_busy (const struct ata_disk *);
 static void select_device (const struct ata_disk *);
 static void select_device_wait (const struct ata_disk *);
 
+static void submit_request (struct ata_disk *, block_sector_t,
+                            block_sector_t cnt, void *, bool write);
+static thread_func dispatcher;
+
 static void interrupt_handler (struct intr_frame *);
 
 /* Initialize the disk subsystem and detect disks. */
 void
 ide_init (void) 
 {
+  uint16_t bm_base = ide_dma_disabled ? 0 : find_bus_master ();
   size_t chan_no;
 
   for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++)
     {
       struct channel *c = &channels[chan_no];
+      char thread_name[16];
       int dev_no;
 
       /* Initialize channel. */
@@ -124,8 +240,18 @@ ide_init (void)
           NOT_REACHED ();
         }
       lock_init (&c->lock);
+      lock_set_name (&c->lock, c->name);
+      list_init (&c->queue);
+      cond_init (&c->queue_nonempty);
+      c->head_pos = 0;
+      c->request_cnt = c->travel = c->fifo_travel = 0;
+      c->fifo_pos = 0;
+      c->queue_len = c->peak_queue_len = 0;
+      c->max_latency = c->max_service = 0;
       c->expecting_interrupt = false;
       sema_init (&c->completion_wait, 0);
+      c->bm_base = bm_base != 0 ? bm_base + chan_no * 8 : 0;
+      c->prdt = prd_tables[chan_no];
  
       /* Initialize devices. */
       for (dev_no = 0; dev_no < 2; dev_no++)
@@ -136,11 +262,18 @@ ide_init (void)
           d->channel = c;
           d->dev_no = dev_no;
           d->is_ata = false;
+          d->multiple_cnt = 0;
+          d->use_dma = false;
         }
 
       /* Register interrupt handler. */
       intr_register_ext (c->irq, interrupt_handler, c->name);
 
+      /* Start the dispatcher, which partition scanning during
+         identification already relies on. */
+      snprintf (thread_name, sizeof thread_name, "%s-dispatch", c->name);
+      thread_create (thread_name, PRI_MAX, dispatcher, c);
+
       /* Reset hardware. */
       reset_channel (c);
 
@@ -155,6 +288,55 @@ ide_init (void)
     }
 }
 
+/* Prints IDE statistics.  Besides the head travel of the
+   requests in the order carried out, reports the travel that
+   carrying out the same requests in arrival order would have
+   taken, for comparison. */
+void
+ide_print_stats (void)
+{
+  struct channel *c;
+
+  printf ("IDE: %llu sectors by DMA, %llu sectors by PIO\n",
+          dma_sector_cnt, pio_sector_cnt);
+  for (c = channels; c < channels + CHANNEL_CNT; c++)
+    if (c->request_cnt > 0)
+      printf ("%s: %llu requests, %llu sectors of head travel "
+              "(%llu in arrival order), peak queue %zu, "
+              "max latency %"PRId64" ticks, "
+              "max service %"PRId64" ticks\n",
+              c->name, c->request_cnt, c->travel, c->fifo_travel,
+              c->peak_queue_len, c->max_latency, c->max_service);
+}
+
+/* Looks for a PCI IDE controller that can act as a bus master
+   and enables bus mastering on it.  Returns the base I/O port of
+   its bus master registers, or 0 if there is none. */
+static uint16_t
+find_bus_master (void)
+{
+  struct pci_address addr;
+  uint32_t bar4;
+
+  /* Class 1 is mass storage, subclass 1 is IDE. */
+  if (!pci_find_class (0x01, 0x01, &addr))
+    return 0;
+
+  /* Bit 7 of the programming interface says whether the
+     controller supports bus mastering; BAR 4 holds the I/O
+     address of its registers. */
+  if (!(pci_read_config (addr, PCI_REG_CLASS) & (0x80 << 8)))
+    return 0;
+  bar4 = pci_read_config (addr, PCI_REG_BAR0 + 4 * 4);
+  if (!(bar4 & 1) || (bar4 & ~3u) == 0)
+    return 0;
+
+  pci_write_config (addr, PCI_REG_COMMAND,
+                    pci_read_config (addr, PCI_REG_COMMAND)
+                    | PCI_CMD_IO | PCI_CMD_MASTER);
+  return bar4 & 0xfffc;
+}
+
 /* Disk detection and identification. */
 
 static char *descramble_ata_string (char *, int size);
@@ -279,7 +461,7 @@ identify_ata_device (struct ata_disk *d)
       d->is_ata = false;
       return;
     }
-  input_sector (c, id);
+  input_sectors (c, id, 1);
 
   /* Calculate capacity.
      Read model name and serial number. */
@@ -303,12 +485,45 @@ identify_ata_device (struct ata_disk *d)
       return;
     }
 
+  /* Enable READ/WRITE MULTIPLE with the largest block size the
+     disk supports, so that multi-sector transfers interrupt once
+     per block instead of once per sector. */
+  set_multiple_mode (d, id[47 * 2] & 0xff);
+
+  /* Use DMA if both the disk (IDENTIFY word 49, bit 8) and the
+     controller support it. */
+  d->use_dma = c->bm_base != 0 && (id[49 * 2 + 1] & 0x01) != 0;
+  if (d->use_dma)
+    strlcat (extra_info, ", DMA", sizeof extra_info);
+
   /* Register. */
   block = block_register (d->name, BLOCK_RAW, extra_info, capacity,
                           &ide_operations, d);
   partition_scan (block);
 }
 
+/* Sets disk D to transfer CNT sectors per interrupt in READ and
+   WRITE MULTIPLE commands.  On success sets D's multiple_cnt
+   member to CNT; otherwise, or if CNT is not a power of 2
+   greater than 1, leaves it 0 so that those commands go unused. */
+static void
+set_multiple_mode (struct ata_disk *d, int cnt)
+{
+  struct channel *c = d->channel;
+
+  d->multiple_cnt = 0;
+  if (cnt <= 1 || (cnt & (cnt - 1)) != 0)
+    return;
+
+  select_device_wait (d);
+  outb (reg_nsect (c), cnt);
+  issue_pio_command (c, CMD_SET_MULTIPLE_MODE);
+  sema_down (&c->completion_wait);
+  wait_while_busy (d);
+  if ((inb (reg_alt_status (c)) & STA_ERR) == 0)
+    d->multiple_cnt = cnt;
+}
+
 /* Translates STRING, which consists of SIZE bytes in a funky
    format, into a null-terminated string in-place.  Drops
    trailing whitespace and null bytes.  Returns STRING.  */
@@ -337,23 +552,334 @@ descramble_ata_string (char *string, int size)
   return string;
 }
 
-/* Reads sector SEC_NO from disk D into BUFFER, which must have
-   room for BLOCK_SECTOR_SIZE bytes.
+/* Reads CNT sectors starting at SEC_NO from disk D into BUFFER,
+   which must have room for CNT * BLOCK_SECTOR_SIZE bytes.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void
+ide_read_multiple (void *d, block_sector_t sec_no, block_sector_t cnt,
+                   void *buffer)
+{
+  submit_request (d, sec_no, cnt, buffer, false);
+}
+
+/* Writes CNT sectors starting at SEC_NO to disk D from BUFFER,
+   which must contain CNT * BLOCK_SECTOR_SIZE bytes.  Returns
+   after the disk has acknowledged receiving the data.
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 static void
-ide_read (void *d_, block_sector_t sec_no, void *buffer)
+ide_write_multiple (void *d, block_sector_t sec_no, block_sector_t cnt,
+                    const void *buffer)
+{
+  submit_request (d, sec_no, cnt, (void *) buffer, true);
+}
+
+/* Returns the elevator position of the first sector of request
+   R: disks are ordered master first, then by sector. */
+static uint64_t
+request_pos (const struct ide_request *r)
+{
+  return ((uint64_t) r->disk->dev_no << 32) | r->sec_no;
+}
+
+/* Returns the distance between elevator positions A and B. */
+static uint64_t
+pos_distance (uint64_t a, uint64_t b)
+{
+  return a >= b ? a - b : b - a;
+}
+
+/* Returns true if request A precedes request B in elevator
+   order. */
+static bool
+request_less (const struct list_elem *a_, const struct list_elem *b_,
+              void *aux UNUSED)
+{
+  const struct ide_request *a = list_entry (a_, struct ide_request, elem);
+  const struct ide_request *b = list_entry (b_, struct ide_request, elem);
+  return request_pos (a) < request_pos (b);
+}
+
+/* Queues a request to transfer CNT sectors starting at SEC_NO
+   between disk D and BUFFER, writing to the disk if WRITE is
+   true and reading from it otherwise, and waits for the
+   dispatcher to carry it out.  BUFFER must be in kernel memory,
+   since the dispatcher cannot see user mappings; the block layer
+   stages transfers to and from user memory through kernel
+   pages. */
+static void
+submit_request (struct ata_disk *d, block_sector_t sec_no,
+                block_sector_t cnt, void *buffer, bool write)
 {
-  struct ata_disk *d = d_;
   struct channel *c = d->channel;
+  struct ide_request r;
+
+  r.disk = d;
+  r.sec_no = sec_no;
+  r.cnt = cnt;
+  r.buffer = buffer;
+  r.write = write;
+  r.start = timer_ticks ();
+  sema_init (&r.done, 0);
+
   lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-  sema_down (&c->completion_wait);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-  input_sector (c, buffer);
+  c->fifo_travel += pos_distance (request_pos (&r), c->fifo_pos);
+  c->fifo_pos = request_pos (&r) + cnt;
+  list_insert_ordered (&c->queue, &r.elem, request_less, NULL);
+  if (++c->queue_len > c->peak_queue_len)
+    c->peak_queue_len = c->queue_len;
+  cond_signal (&c->queue_nonempty, &c->lock);
   lock_release (&c->lock);
+
+  sema_down (&r.done);
+}
+
+/* Removes and returns the request that channel C should carry
+   out next: in C-LOOK order, the first one at or past the
+   position where the last one ended, or if there is none, the
+   lowest one.  The caller must hold C's lock, and C's queue must
+   not be empty. */
+static struct ide_request *
+next_request (struct channel *c)
+{
+  struct list_elem *e;
+  struct ide_request *r;
+
+  ASSERT (lock_held_by_current_thread (&c->lock));
+  ASSERT (!list_empty (&c->queue));
+
+  for (e = list_begin (&c->queue); e != list_end (&c->queue);
+       e = list_next (e))
+    if (request_pos (list_entry (e, struct ide_request, elem)) >= c->head_pos)
+      break;
+  if (e == list_end (&c->queue))
+    e = list_begin (&c->queue);
+
+  r = list_entry (e, struct ide_request, elem);
+  list_remove (&r->elem);
+  c->queue_len--;
+  return r;
+}
+
+/* Carries out request R, in pieces of up to MAX_XFER_SECTORS
+   sectors, by DMA if possible.  Only the dispatcher of R's disk's
+   channel may call this function. */
+static void
+do_request (struct ide_request *r)
+{
+  uint8_t *p = r->buffer;
+  block_sector_t sec_no = r->sec_no;
+  block_sector_t cnt = r->cnt;
+
+  while (cnt > 0)
+    {
+      size_t xfer_cnt = cnt < MAX_XFER_SECTORS ? cnt : MAX_XFER_SECTORS;
+
+      if (!dma_transfer (r->disk, sec_no, xfer_cnt, p, r->write))
+        {
+          if (r->write)
+            pio_write (r->disk, sec_no, xfer_cnt, p);
+          else
+            pio_read (r->disk, sec_no, xfer_cnt, p);
+        }
+      p += xfer_cnt * BLOCK_SECTOR_SIZE;
+      sec_no += xfer_cnt;
+      cnt -= xfer_cnt;
+    }
+}
+
+/* Dispatcher thread for channel C_.  Carries out the requests
+   queued on the channel one after another, waking each
+   requester when its request is done. */
+static void
+dispatcher (void *c_)
+{
+  struct channel *c = c_;
+
+  for (;;)
+    {
+      struct ide_request *r;
+      uint64_t pos;
+      int64_t start, latency, service;
+
+      lock_acquire (&c->lock);
+      while (list_empty (&c->queue))
+        cond_wait (&c->queue_nonempty, &c->lock);
+      r = next_request (c);
+      lock_release (&c->lock);
+
+      start = timer_ticks ();
+      do_request (r);
+      service = timer_elapsed (start);
+
+      lock_acquire (&c->lock);
+      pos = request_pos (r);
+      c->travel += pos_distance (pos, c->head_pos);
+      c->head_pos = pos + r->cnt;
+      c->request_cnt++;
+      latency = timer_elapsed (r->start);
+      if (latency > c->max_latency)
+        c->max_latency = latency;
+      if (service > c->max_service)
+        c->max_service = service;
+      lock_release (&c->lock);
+
+      sema_up (&r->done);
+    }
+}
+
+/* Reads CNT sectors, at most MAX_XFER_SECTORS, starting at
+   SEC_NO from disk D into BUFFER in PIO mode, using READ
+   MULTIPLE if the disk supports it.  Only the dispatcher of D's
+   channel may call this function. */
+static void
+pio_read (struct ata_disk *d, block_sector_t sec_no, size_t cnt,
+          void *buffer)
+{
+  struct channel *c = d->channel;
+  bool multiple = d->multiple_cnt > 0 && cnt > 1;
+  size_t block_cnt = multiple ? d->multiple_cnt : 1;
+  uint8_t *p = buffer;
+  size_t i;
+
+  select_sector (d, sec_no, cnt);
+  issue_pio_command (c, multiple ? CMD_READ_MULTIPLE : CMD_READ_SECTOR_RETRY);
+
+  /* The disk interrupts once for each block of data ready. */
+  for (i = 0; i < cnt; i += block_cnt)
+    {
+      size_t n = cnt - i < block_cnt ? cnt - i : block_cnt;
+      sema_down (&c->completion_wait);
+      if (!wait_while_busy (d))
+        PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no + i);
+      input_sectors (c, p, n);
+      p += n * BLOCK_SECTOR_SIZE;
+    }
+  pio_sector_cnt += cnt;
+}
+
+/* Writes CNT sectors, at most MAX_XFER_SECTORS, starting at
+   SEC_NO to disk D from BUFFER in PIO mode, using WRITE MULTIPLE
+   if the disk supports it.  Only the dispatcher of D's channel
+   may call this function. */
+static void
+pio_write (struct ata_disk *d, block_sector_t sec_no, size_t cnt,
+           const void *buffer)
+{
+  struct channel *c = d->channel;
+  bool multiple = d->multiple_cnt > 0 && cnt > 1;
+  size_t block_cnt = multiple ? d->multiple_cnt : 1;
+  const uint8_t *p = buffer;
+  size_t i;
+
+  select_sector (d, sec_no, cnt);
+  issue_pio_command (c, multiple ? CMD_WRITE_MULTIPLE
+                                 : CMD_WRITE_SECTOR_RETRY);
+
+  /* The disk asks for each block of data in turn and interrupts
+     once it has accepted it. */
+  for (i = 0; i < cnt; i += block_cnt)
+    {
+      size_t n = cnt - i < block_cnt ? cnt - i : block_cnt;
+      if (!wait_while_busy (d))
+        PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no + i);
+      output_sectors (c, p, n);
+      p += n * BLOCK_SECTOR_SIZE;
+      sema_down (&c->completion_wait);
+    }
+  pio_sector_cnt += cnt;
+}
+
+/* Fills in the PRD table of channel C to describe the SIZE bytes
+   at BUFFER.  Returns true if successful, false if BUFFER is not
+   in kernel memory or needs too many descriptors. */
+static bool
+setup_prdt (struct channel *c, void *buffer, size_t size)
+{
+  uint8_t *p = buffer;
+  size_t i;
+
+  if (!is_kernel_vaddr (p) || !is_kernel_vaddr (p + size - 1))
+    return false;
+
+  for (i = 0; i < PRD_CNT; i++)
+    {
+      uintptr_t phys = vtop (p);
+      size_t boundary_left = 0x10000 - (phys & 0xffff);
+      size_t chunk = size < boundary_left ? size : boundary_left;
+
+      c->prdt[i].addr = phys;
+      c->prdt[i].size = chunk & 0xffff;
+      c->prdt[i].flags = 0;
+      p += chunk;
+      size -= chunk;
+      if (size == 0)
+        {
+          c->prdt[i].flags = PRD_EOT;
+          return true;
+        }
+    }
+  return false;
+}
+
+/* Transfers CNT sectors, at most MAX_XFER_SECTORS, starting at
+   SEC_NO between disk D and BUFFER by DMA, writing to the disk
+   if WRITE is true and reading from it otherwise.  The CPU is
+   free to run other threads until the completion interrupt.
+   Returns true if successful.  Returns false if D does not use
+   DMA, BUFFER is unsuitable, or the transfer fails, in which
+   case the caller should fall back to PIO.  After a failed
+   transfer, D uses PIO from then on.  Only the dispatcher of D's
+   channel may call this function. */
+static bool
+dma_transfer (struct ata_disk *d, block_sector_t sec_no, size_t cnt,
+              void *buffer, bool write)
+{
+  struct channel *c = d->channel;
+  uint8_t direction = write ? 0 : BM_CMD_READ;
+  uint8_t bm_status, status;
+
+  if (!d->use_dma || !setup_prdt (c, buffer, cnt * BLOCK_SECTOR_SIZE))
+    return false;
+
+  /* Program the bus master, clearing stale status bits by
+     writing 1s to them. */
+  outl (reg_bm_prdt (c), vtop (c->prdt));
+  outb (reg_bm_command (c), direction);
+  outb (reg_bm_status (c),
+        inb (reg_bm_status (c)) | BM_STA_ERR | BM_STA_INTR);
+
+  /* Issue the command, then start the bus master. */
+  select_sector (d, sec_no, cnt);
+  issue_pio_command (c, write ? CMD_WRITE_DMA : CMD_READ_DMA);
+  outb (reg_bm_command (c), direction | BM_CMD_START);
+  sema_down (&c->completion_wait);
+
+  /* Stop the bus master and check the outcome. */
+  outb (reg_bm_command (c), direction);
+  bm_status = inb (reg_bm_status (c));
+  outb (reg_bm_status (c), bm_status | BM_STA_ERR | BM_STA_INTR);
+  status = inb (reg_alt_status (c));
+  if ((bm_status & BM_STA_ERR) || (status & STA_ERR))
+    {
+      printf ("%s: DMA %s failed, sector=%"PRDSNu", falling back to PIO\n",
+              d->name, write ? "write" : "read", sec_no);
+      d->use_dma = false;
+      return false;
+    }
+  dma_sector_cnt += cnt;
+  return true;
+}
+
+/* Reads sector SEC_NO from disk D into BUFFER, which must have
+   room for BLOCK_SECTOR_SIZE bytes.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void
+ide_read (void *d, block_sector_t sec_no, void *buffer)
+{
+  ide_read_multiple (d, sec_no, 1, buffer);
 }
 
 /* Write sector SEC_NO to disk D from BUFFER, which must contain
@@ -362,38 +888,33 @@ ide_read (void *d_, block_sector_t sec_no, void *buffer)
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 static void
-ide_write (void *d_, block_sector_t sec_no, const void *buffer)
+ide_write (void *d, block_sector_t sec_no, const void *buffer)
 {
-  struct ata_disk *d = d_;
-  struct channel *c = d->channel;
-  lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-  output_sector (c, buffer);
-  sema_down (&c->completion_wait);
-  lock_release (&c->lock);
+  ide_write_multiple (d, sec_no, 1, buffer);
 }
 
 static struct block_operations ide_operations =
   {
     ide_read,
-    ide_write
+    ide_write,
+    ide_read_multiple,
+    ide_write_multiple
   };
-
+
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO and the sector count CNT, which must be between
+   1 and MAX_XFER_SECTORS, to the disk's sector selection
+   registers.  (We use LBA mode.) */
 static void
-select_sector (struct ata_disk *d, block_sector_t sec_no)
+select_sector (struct ata_disk *d, block_sector_t sec_no, size_t cnt)
 {
   struct channel *c = d->channel;
 
   ASSERT (sec_no < (1UL << 28));
+  ASSERT (cnt >= 1 && cnt <= MAX_XFER_SECTORS);
   
   select_device_wait (d);
-  outb (reg_nsect (c), 1);
+  outb (reg_nsect (c), cnt % MAX_XFER_SECTORS);
   outb (reg_lbal (c), sec_no);
   outb (reg_lbam (c), sec_no >> 8);
   outb (reg_lbah (c), (sec_no >> 16));
@@ -414,20 +935,21 @@ issue_pio_command (struct channel *c, uint8_t command)
   outb (reg_command (c), command);
 }
 
-/* Reads a sector from channel C's data register in PIO mode into
-   SECTOR, which must have room for BLOCK_SECTOR_SIZE bytes. */
+/* Reads CNT sectors from channel C's data register in PIO mode
+   into SECTORS, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes. */
 static void
-input_sector (struct channel *c, void *sector) 
+input_sectors (struct channel *c, void *sectors, size_t cnt) 
 {
-  insw (reg_data (c), sector, BLOCK_SECTOR_SIZE / 2);
+  insw (reg_data (c), sectors, cnt * BLOCK_SECTOR_SIZE / 2);
 }
 
-/* Writes SECTOR to channel C's data register in PIO mode.
-   SECTOR must contain BLOCK_SECTOR_SIZE bytes. */
+/* Writes CNT sectors to channel C's data register in PIO mode.
+   SECTORS must contain CNT * BLOCK_SECTOR_SIZE bytes. */
 static void
-output_sector (struct channel *c, const void *sector) 
+output_sectors (struct channel *c, const void *sectors, size_t cnt) 
 {
-  outsw (reg_data (c), sector, BLOCK_SECTOR_SIZE / 2);
+  outsw (reg_data (c), sectors, cnt * BLOCK_SECTOR_SIZE / 2);
 }
 
 /* Low-level ATA primitives. */
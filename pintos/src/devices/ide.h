@@ -1,6 +1,13 @@
 #ifndef DEVICES_IDE_H
 #define DEVICES_IDE_H
 
+#include <stdbool.h>
+
+/* Force PIO transfers even if DMA is available.
+   Controlled by kernel command-line option "-nodma". */
+extern bool ide_dma_disabled;
+
 void ide_init (void);
+void ide_print_stats (void);
 
 #endif /* devices/ide.h */
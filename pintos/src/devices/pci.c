@@ -0,0 +1,88 @@
+#include "devices/pci.h"
+#include <debug.h>
+#include "threads/io.h"
+
+/* This code accesses PCI configuration space through the
+   configuration mechanism #1 ports that every PC chipset since
+   the PCI 2.0 era provides.  See [PCI] for details. */
+
+/* I/O port addresses. */
+#define PCI_CONFIG_ADDRESS 0xcf8        /* Selects a config register. */
+#define PCI_CONFIG_DATA 0xcfc           /* Reads or writes it. */
+
+/* Header type bit for devices with more than one function. */
+#define PCI_HEADER_MULTIFUNC 0x80
+
+/* Selects configuration register REG, which must be a multiple
+   of 4, of the function at ADDR. */
+static void
+select_config (struct pci_address addr, uint8_t reg)
+{
+  ASSERT (addr.dev < 32 && addr.func < 8);
+  ASSERT (reg % 4 == 0);
+
+  outl (PCI_CONFIG_ADDRESS, (1u << 31) | (addr.bus << 16) | (addr.dev << 11)
+                            | (addr.func << 8) | reg);
+}
+
+/* Returns the 32-bit configuration register REG of the function
+   at ADDR.  REG must be a multiple of 4. */
+uint32_t
+pci_read_config (struct pci_address addr, uint8_t reg)
+{
+  select_config (addr, reg);
+  return inl (PCI_CONFIG_DATA);
+}
+
+/* Sets the 32-bit configuration register REG of the function at
+   ADDR to VALUE.  REG must be a multiple of 4. */
+void
+pci_write_config (struct pci_address addr, uint8_t reg, uint32_t value)
+{
+  select_config (addr, reg);
+  outl (PCI_CONFIG_DATA, value);
+}
+
+/* Searches every PCI bus for the first function with the given
+   CLASS and SUBCLASS codes.  If one is found, stores its address
+   into *ADDR and returns true; otherwise returns false. */
+bool
+pci_find_class (uint8_t class, uint8_t subclass, struct pci_address *addr)
+{
+  struct pci_address a;
+  int bus, dev, func;
+
+  for (bus = 0; bus < 256; bus++)
+    for (dev = 0; dev < 32; dev++)
+      for (func = 0; func < 8; func++)
+        {
+          uint32_t class_reg;
+
+          a.bus = bus;
+          a.dev = dev;
+          a.func = func;
+          if ((pci_read_config (a, PCI_REG_ID) & 0xffff) == 0xffff)
+            {
+              /* No such function.  If function 0 is missing, so
+                 is the whole device. */
+              if (func == 0)
+                break;
+              continue;
+            }
+
+          class_reg = pci_read_config (a, PCI_REG_CLASS);
+          if ((class_reg >> 24) == class
+              && ((class_reg >> 16) & 0xff) == subclass)
+            {
+              *addr = a;
+              return true;
+            }
+
+          /* Single-function devices only have function 0. */
+          if (func == 0
+              && !(pci_read_config (a, PCI_REG_HEADER)
+                   & (PCI_HEADER_MULTIFUNC << 16)))
+            break;
+        }
+  return false;
+}
@@ -0,0 +1,397 @@
+#include "devices/raid0.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* RAID-0 ("striped") block device.
+
+   Combines several member block devices into one, named "md0",
+   whose sectors are dealt out to the members in turn, a stripe
+   unit at a time: with N members and a stripe unit of U sectors,
+   sector S lives on member (S / U) % N.  A request that covers
+   several stripe units is split into one piece per member: the
+   units that fall on a member are adjacent there, so each member
+   sees a single request, staged through a bounce buffer when it
+   gathers more than one unit.  Pieces for different members are
+   carried out in parallel by a worker thread per member, so that
+   with members on different IDE channels both channels transfer
+   data at the same time.  Compare, e.g., the md0 statistics of
+   "-raid0=hdc,hdd" (one channel) and "-raid0=hdb,hdc" (two).
+
+   The device registers as BLOCK_RAW; use it with, e.g.,
+   "-filesys=md0". */
+
+/* Maximum number of member devices. */
+#define MEMBER_MAX 4
+
+/* A piece of a striped request, within a single member. */
+struct piece
+  {
+    struct list_elem elem;      /* Element in member's queue. */
+    block_sector_t sector;      /* First sector within the member. */
+    block_sector_t cnt;         /* Number of sectors. */
+    size_t unit_cnt;            /* Number of stripe units. */
+    uint8_t *buffer;            /* Data. */
+    bool staged;                /* BUFFER is a bounce buffer? */
+    bool write;                 /* True to write, false to read. */
+    struct semaphore *done;     /* Up'd when the piece is done. */
+  };
+
+/* A member device and its worker thread. */
+struct member
+  {
+    struct block *block;        /* Member device. */
+    struct list queue;          /* Pieces waiting for the worker. */
+    struct lock lock;           /* Protects queue. */
+    struct condition nonempty;  /* Signaled when queue grows. */
+  };
+
+/* A striped device. */
+struct raid0
+  {
+    struct member members[MEMBER_MAX];  /* Member devices. */
+    size_t member_cnt;          /* Number of members. */
+    block_sector_t stripe;      /* Stripe unit in sectors. */
+
+    /* Statistics. */
+    unsigned long long request_cnt;     /* Requests to md0. */
+    unsigned long long striped_cnt;     /* Requests spanning units. */
+    unsigned long long member_req_cnt;  /* Requests to members. */
+    uint64_t striped_cycles;    /* Time in striped requests. */
+  };
+
+/* The striped device, if any. */
+static struct raid0 *md0;
+
+static struct block_operations raid0_operations;
+static thread_func worker;
+
+/* Assembles a striped device from the block devices named in
+   MEMBERS, a comma-separated list, with a stripe unit of
+   STRIPE_SECTORS sectors, and registers it as "md0".  Panics on
+   a bad configuration, since it was requested explicitly. */
+void
+raid0_init (const char *members, unsigned stripe_sectors)
+{
+  struct raid0 *r;
+  block_sector_t member_size = 0;
+  char *copy, *name, *save_ptr;
+  char extra_info[64];
+  size_t i;
+
+  if (stripe_sectors == 0)
+    PANIC ("raid0: stripe unit must be at least 1 sector");
+
+  r = calloc (1, sizeof *r);
+  copy = malloc (strlen (members) + 1);
+  if (r == NULL || copy == NULL)
+    PANIC ("raid0: out of memory");
+  strlcpy (copy, members, strlen (members) + 1);
+  r->stripe = stripe_sectors;
+
+  for (name = strtok_r (copy, ",", &save_ptr); name != NULL;
+       name = strtok_r (NULL, ",", &save_ptr))
+    {
+      struct member *m;
+      char thread_name[16];
+
+      if (r->member_cnt >= MEMBER_MAX)
+        PANIC ("raid0: more than %d members", MEMBER_MAX);
+      m = &r->members[r->member_cnt++];
+      m->block = block_get_by_name (name);
+      if (m->block == NULL)
+        PANIC ("raid0: no such block device \"%s\"", name);
+      if (member_size == 0 || block_size (m->block) < member_size)
+        member_size = block_size (m->block);
+
+      list_init (&m->queue);
+      lock_init (&m->lock);
+      cond_init (&m->nonempty);
+      snprintf (thread_name, sizeof thread_name, "md0-%s", name);
+      thread_create (thread_name, PRI_MAX, worker, m);
+    }
+  if (r->member_cnt < 2)
+    PANIC ("raid0: need at least 2 members");
+
+  snprintf (extra_info, sizeof extra_info, "striped over %zu devices, "
+            "%"PRDSNu"-sector stripe unit", r->member_cnt, r->stripe);
+  for (i = 0; i < r->member_cnt; i++)
+    printf ("md0: member %zu is %s\n", i, block_name (r->members[i].block));
+  block_register ("md0", BLOCK_RAW, extra_info,
+                  member_size / r->stripe * r->stripe * r->member_cnt,
+                  &raid0_operations, r);
+  md0 = r;
+  free (copy);
+}
+
+/* Prints striped device statistics. */
+void
+raid0_print_stats (void)
+{
+  if (md0 != NULL)
+    printf ("md0: %llu requests, %llu striped, %llu member requests, "
+            "%"PRIu64" cycles in striped requests\n",
+            md0->request_cnt, md0->striped_cnt, md0->member_req_cnt,
+            md0->striped_cycles);
+}
+
+/* Adds a request to R's statistics that was carried out with
+   MEMBER_REQ_CNT member requests, starting at time START if it
+   spanned several stripe units, or 0 if it did not. */
+static void
+count_request (struct raid0 *r, size_t member_req_cnt, uint64_t start)
+{
+  enum intr_level old_level = intr_disable ();
+  r->request_cnt++;
+  r->member_req_cnt += member_req_cnt;
+  if (start != 0)
+    {
+      r->striped_cnt++;
+      r->striped_cycles += rdtsc () - start;
+    }
+  intr_set_level (old_level);
+}
+
+/* Copies the stripe units of the CNT-sector request at SECTOR of
+   R that fall on the member at offset MEMBER_OFS in the request's
+   rotation between BUFFER, the caller's data, and STAGING, the
+   member's bounce buffer: into STAGING if GATHER is true,
+   otherwise out of it. */
+static void
+copy_units (struct raid0 *r, block_sector_t sector, block_sector_t cnt,
+            uint8_t *buffer, size_t member_ofs, uint8_t *staging,
+            bool gather)
+{
+  block_sector_t ofs = sector % r->stripe;
+  size_t unit;
+
+  for (unit = 0; cnt > 0; unit++)
+    {
+      block_sector_t n = r->stripe - ofs < cnt ? r->stripe - ofs : cnt;
+      size_t size = n * BLOCK_SECTOR_SIZE;
+
+      if (unit % r->member_cnt == member_ofs)
+        {
+          if (gather)
+            memcpy (staging, buffer, size);
+          else
+            memcpy (buffer, staging, size);
+          staging += size;
+        }
+      buffer += size;
+      cnt -= n;
+      ofs = 0;
+    }
+}
+
+/* Carries out the CNT-sector request at SECTOR of R to or from
+   BUFFER one stripe unit at a time in the calling thread, for
+   when bounce buffers cannot be allocated. */
+static void
+transfer_units (struct raid0 *r, block_sector_t sector, block_sector_t cnt,
+                uint8_t *buffer, bool write)
+{
+  while (cnt > 0)
+    {
+      block_sector_t stripe_idx = sector / r->stripe;
+      block_sector_t stripe_ofs = sector % r->stripe;
+      struct member *m = &r->members[stripe_idx % r->member_cnt];
+      block_sector_t member_sector
+        = stripe_idx / r->member_cnt * r->stripe + stripe_ofs;
+      block_sector_t n = r->stripe - stripe_ofs < cnt
+                         ? r->stripe - stripe_ofs : cnt;
+
+      if (write)
+        block_write_multiple (m->block, member_sector, n, buffer);
+      else
+        block_read_multiple (m->block, member_sector, n, buffer);
+      buffer += n * BLOCK_SECTOR_SIZE;
+      sector += n;
+      cnt -= n;
+    }
+}
+
+/* Splits the request to transfer CNT sectors starting at SECTOR
+   of striped device R to or from BUFFER into pieces, one per
+   member, hands each to its member's worker, and waits for all
+   of them.  A request within a single stripe unit is carried out
+   directly. */
+static void
+raid0_transfer (struct raid0 *r, block_sector_t sector, block_sector_t cnt,
+                uint8_t *buffer, bool write)
+{
+  block_sector_t stripe_idx = sector / r->stripe;
+  block_sector_t stripe_ofs = sector % r->stripe;
+  struct member *m = &r->members[stripe_idx % r->member_cnt];
+  block_sector_t member_sector
+    = stripe_idx / r->member_cnt * r->stripe + stripe_ofs;
+  struct piece pieces[MEMBER_MAX];
+  struct semaphore done;
+  block_sector_t left;
+  uint8_t *p_buffer;
+  size_t piece_cnt, unit, i;
+  uint64_t start;
+
+  if (stripe_ofs + cnt <= r->stripe)
+    {
+      if (write)
+        block_write_multiple (m->block, member_sector, cnt, buffer);
+      else
+        block_read_multiple (m->block, member_sector, cnt, buffer);
+      count_request (r, 1, 0);
+      return;
+    }
+  start = rdtsc ();
+
+  /* Lay out one piece per member.  The units that fall on a
+     member lie N units apart in the request but back to back
+     on the member. */
+  piece_cnt = (stripe_ofs + cnt + r->stripe - 1) / r->stripe;
+  if (piece_cnt > r->member_cnt)
+    piece_cnt = r->member_cnt;
+  p_buffer = buffer;
+  left = cnt;
+  for (unit = 0; left > 0; unit++)
+    {
+      struct piece *p = &pieces[unit % r->member_cnt];
+      block_sector_t ofs = unit == 0 ? stripe_ofs : 0;
+      block_sector_t n = r->stripe - ofs < left ? r->stripe - ofs : left;
+
+      if (unit < r->member_cnt)
+        {
+          p->sector = (stripe_idx + unit) / r->member_cnt * r->stripe + ofs;
+          p->cnt = 0;
+          p->unit_cnt = 0;
+          p->buffer = p_buffer;
+          p->staged = false;
+        }
+      p->cnt += n;
+      p->unit_cnt++;
+      p_buffer += n * BLOCK_SECTOR_SIZE;
+      left -= n;
+    }
+
+  /* Gather the units of pieces that have more than one into
+     bounce buffers. */
+  for (i = 0; i < piece_cnt; i++)
+    {
+      struct piece *p = &pieces[i];
+
+      if (p->unit_cnt > 1)
+        {
+          p->buffer = malloc (p->cnt * BLOCK_SECTOR_SIZE);
+          if (p->buffer == NULL)
+            {
+              while (i-- > 0)
+                if (pieces[i].staged)
+                  free (pieces[i].buffer);
+              transfer_units (r, sector, cnt, buffer, write);
+              count_request (r, (stripe_ofs + cnt + r->stripe - 1)
+                                / r->stripe, start);
+              return;
+            }
+          p->staged = true;
+          if (write)
+            copy_units (r, sector, cnt, buffer, i, p->buffer, true);
+        }
+    }
+
+  sema_init (&done, 0);
+  for (i = 0; i < piece_cnt; i++)
+    {
+      struct piece *p = &pieces[i];
+
+      m = &r->members[(stripe_idx + i) % r->member_cnt];
+      p->write = write;
+      p->done = &done;
+
+      lock_acquire (&m->lock);
+      list_push_back (&m->queue, &p->elem);
+      cond_signal (&m->nonempty, &m->lock);
+      lock_release (&m->lock);
+    }
+
+  for (i = 0; i < piece_cnt; i++)
+    sema_down (&done);
+  for (i = 0; i < piece_cnt; i++)
+    if (pieces[i].staged)
+      {
+        if (!write)
+          copy_units (r, sector, cnt, buffer, i, pieces[i].buffer, false);
+        free (pieces[i].buffer);
+      }
+  count_request (r, piece_cnt, start);
+}
+
+/* Worker thread for member M_.  Carries out the pieces queued
+   for the member in order. */
+static void
+worker (void *m_)
+{
+  struct member *m = m_;
+
+  for (;;)
+    {
+      struct piece *p;
+
+      lock_acquire (&m->lock);
+      while (list_empty (&m->queue))
+        cond_wait (&m->nonempty, &m->lock);
+      p = list_entry (list_pop_front (&m->queue), struct piece, elem);
+      lock_release (&m->lock);
+
+      if (p->write)
+        block_write_multiple (m->block, p->sector, p->cnt, p->buffer);
+      else
+        block_read_multiple (m->block, p->sector, p->cnt, p->buffer);
+      sema_up (p->done);
+    }
+}
+
+/* Reads sector SECTOR from striped device R_ into BUFFER. */
+static void
+raid0_read (void *r_, block_sector_t sector, void *buffer)
+{
+  raid0_transfer (r_, sector, 1, buffer, false);
+}
+
+/* Writes sector SECTOR to striped device R_ from BUFFER. */
+static void
+raid0_write (void *r_, block_sector_t sector, const void *buffer)
+{
+  raid0_transfer (r_, sector, 1, (void *) buffer, true);
+}
+
+/* Reads CNT sectors starting at SECTOR from striped device R_
+   into BUFFER. */
+static void
+raid0_read_multiple (void *r_, block_sector_t sector, block_sector_t cnt,
+                     void *buffer)
+{
+  raid0_transfer (r_, sector, cnt, buffer, false);
+}
+
+/* Writes CNT sectors starting at SECTOR to striped device R_ from
+   BUFFER. */
+static void
+raid0_write_multiple (void *r_, block_sector_t sector, block_sector_t cnt,
+                      const void *buffer)
+{
+  raid0_transfer (r_, sector, cnt, (void *) buffer, true);
+}
+
+static struct block_operations raid0_operations =
+  {
+    raid0_read,
+    raid0_write,
+    raid0_read_multiple,
+    raid0_write_multiple
+  };
@@ -0,0 +1,10 @@
+#ifndef DEVICES_RAID0_H
+#define DEVICES_RAID0_H
+
+/* Default stripe unit, in sectors. */
+#define RAID0_DEFAULT_STRIPE 16
+
+void raid0_init (const char *members, unsigned stripe_sectors);
+void raid0_print_stats (void);
+
+#endif /* devices/raid0.h */
@@ -0,0 +1,120 @@
+#include "devices/ramdisk.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* RAM-backed block device.
+
+   Keeps its sectors in pages from the kernel pool, so that file
+   systems, scratch and swap can be used without paying for an
+   emulated disk.  Its contents vanish at power off.  Ramdisks
+   are named "ram0", "ram1", and so on, in order of creation. */
+
+/* Sectors per page. */
+#define SECTORS_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* A ramdisk. */
+struct ramdisk
+  {
+    uint8_t **pages;            /* Pages holding the sectors. */
+    size_t page_cnt;            /* Number of pages. */
+  };
+
+/* Number of ramdisks created so far. */
+static int ramdisk_cnt;
+
+static struct block_operations ramdisk_operations;
+
+/* Creates a ramdisk of SIZE sectors, initially all zeros, and
+   registers it as a block device of the given TYPE.  Ramdisks
+   created before ide_init() come first in probe order, so that
+   they take precedence over disks in the roles their TYPE names.
+   Panics if the kernel pool is too small. */
+struct block *
+ramdisk_create (enum block_type type, block_sector_t size)
+{
+  struct ramdisk *rd;
+  char name[16];
+  size_t i;
+
+  ASSERT (type < BLOCK_CNT);
+
+  rd = malloc (sizeof *rd);
+  if (rd == NULL)
+    PANIC ("ramdisk: out of memory");
+  rd->page_cnt = DIV_ROUND_UP (size, SECTORS_PER_PAGE);
+  rd->pages = malloc (rd->page_cnt * sizeof *rd->pages);
+  if (rd->pages == NULL)
+    PANIC ("ramdisk: out of memory");
+  for (i = 0; i < rd->page_cnt; i++)
+    {
+      rd->pages[i] = palloc_get_page (PAL_ZERO);
+      if (rd->pages[i] == NULL)
+        PANIC ("ramdisk: kernel pool exhausted after %zu of %zu pages",
+               i, rd->page_cnt);
+    }
+
+  snprintf (name, sizeof name, "ram%d", ramdisk_cnt++);
+  return block_register (name, type, "RAM disk", size,
+                         &ramdisk_operations, rd);
+}
+
+/* Returns the address of sector SECTOR of ramdisk RD. */
+static uint8_t *
+sector_addr (struct ramdisk *rd, block_sector_t sector)
+{
+  return (rd->pages[sector / SECTORS_PER_PAGE]
+          + sector % SECTORS_PER_PAGE * BLOCK_SECTOR_SIZE);
+}
+
+/* Reads CNT sectors starting at SECTOR from ramdisk RD_ into
+   BUFFER. */
+static void
+ramdisk_read_multiple (void *rd_, block_sector_t sector, block_sector_t cnt,
+                       void *buffer)
+{
+  struct ramdisk *rd = rd_;
+  uint8_t *p = buffer;
+
+  for (; cnt > 0; cnt--, sector++, p += BLOCK_SECTOR_SIZE)
+    memcpy (p, sector_addr (rd, sector), BLOCK_SECTOR_SIZE);
+}
+
+/* Writes CNT sectors starting at SECTOR to ramdisk RD_ from
+   BUFFER. */
+static void
+ramdisk_write_multiple (void *rd_, block_sector_t sector, block_sector_t cnt,
+                        const void *buffer)
+{
+  struct ramdisk *rd = rd_;
+  const uint8_t *p = buffer;
+
+  for (; cnt > 0; cnt--, sector++, p += BLOCK_SECTOR_SIZE)
+    memcpy (sector_addr (rd, sector), p, BLOCK_SECTOR_SIZE);
+}
+
+/* Reads sector SECTOR from ramdisk RD into BUFFER. */
+static void
+ramdisk_read (void *rd, block_sector_t sector, void *buffer)
+{
+  ramdisk_read_multiple (rd, sector, 1, buffer);
+}
+
+/* Writes sector SECTOR to ramdisk RD from BUFFER. */
+static void
+ramdisk_write (void *rd, block_sector_t sector, const void *buffer)
+{
+  ramdisk_write_multiple (rd, sector, 1, buffer);
+}
+
+static struct block_operations ramdisk_operations =
+  {
+    ramdisk_read,
+    ramdisk_write,
+    ramdisk_read_multiple,
+    ramdisk_write_multiple
+  };
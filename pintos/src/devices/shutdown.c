@@ -5,13 +5,22 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "threads/io.h"
+#include "threads/lockstat.h"
+#include "threads/trace.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
 #endif
 #ifdef FILESYS
 #include "devices/block.h"
+#include "devices/ide.h"
+#include "devices/raid0.h"
+#include "filesys/dcache.h"
 #include "filesys/filesys.h"
+#include "filesys/free-map.h"
+#include "filesys/inode.h"
+#include "filesys/journal.h"
 #endif
 
 /* Keyboard control register port. */
@@ -95,6 +104,7 @@ shutdown_power_off (void)
 #endif
 
   print_stats ();
+  trace_dump ();
 
   printf ("Powering off...\n");
   serial_flush ();
@@ -120,11 +130,19 @@ print_stats (void)
 {
   timer_print_stats ();
   thread_print_stats ();
+  workqueue_print_stats ();
 #ifdef FILESYS
   block_print_stats ();
+  ide_print_stats ();
+  raid0_print_stats ();
+  free_map_print_stats ();
+  inode_print_stats ();
+  journal_print_stats ();
+  dcache_print_stats ();
 #endif
   console_print_stats ();
   kbd_print_stats ();
+  lockstat_print_stats ();
 #ifdef USERPROG
   exception_print_stats ();
 #endif
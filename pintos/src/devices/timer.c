@@ -7,6 +7,7 @@
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 #include "../lib/kernel/list.h"
   
 /* See [8254] for hardware details of the 8254 timer chip. */
@@ -19,8 +20,11 @@
 #endif
 
 
-/* Number of timer ticks since OS booted. */
+/* Number of timer ticks since OS booted.  Written only by the
+   timer interrupt; ticks_seq lets timer_ticks() read all 64 bits
+   consistently without disabling interrupts. */
 static int64_t ticks;
+static struct seqlock ticks_seq;
 
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
@@ -29,6 +33,12 @@ static unsigned loops_per_tick;
 // list of sleeping threads
 static struct list sleep_list;
 
+/* Wakes the threads in sleep_list that are due.  Queued by the
+   timer interrupt, so that the list walk and the wakeups run in
+   a worker thread rather than in the interrupt handler. */
+static struct work wakeup_work;
+static work_func wake_sleepers;
+
 static intr_handler_func timer_interrupt;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
@@ -41,8 +51,10 @@ void
 timer_init (void) 
 {
   pit_configure_channel (0, 2, TIMER_FREQ);
+  seqlock_init (&ticks_seq);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
   list_init(&sleep_list); // initialize sleep_list
+  work_init (&wakeup_work, wake_sleepers, NULL);
 }
 
 /* Calibrates loops_per_tick, used to implement brief delays. */
@@ -76,9 +88,15 @@ timer_calibrate (void)
 int64_t
 timer_ticks (void) 
 {
-  enum intr_level old_level = intr_disable ();
-  int64_t t = ticks;
-  intr_set_level (old_level);
+  unsigned seq;
+  int64_t t;
+
+  do
+    {
+      seq = seqlock_read_begin (&ticks_seq);
+      t = ticks;
+    }
+  while (seqlock_read_retry (&ticks_seq, seq));
   return t;
 }
 
@@ -191,27 +209,43 @@ timer_print_stats (void)
 
 /* Timer interrupt handler. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED)
+timer_interrupt (struct intr_frame *args)
 {
+  enum intr_level old_level = seqlock_write_begin (&ticks_seq);
   ticks++;
-  thread_tick ();
-  
-  struct thread *t;
+  seqlock_write_end (&ticks_seq, old_level);
+  /* The low 2 bits of CS are the interrupted code's privilege
+     level, which is 3 in user code. */
+  thread_tick ((args->cs & 3) == 3);
+  workqueue_tick (ticks);
+
+  /* Only look at the earliest sleeper here; wake_sleepers() does
+     the rest. */
+  if (!list_empty (&sleep_list)
+      && list_entry (list_front (&sleep_list), struct thread,
+                     sleepelem)->wakeup_time <= ticks)
+    work_queue (&wakeup_work);
+}
 
-  enum intr_level old_state;
-  old_state = intr_disable(); // back up current interrupt lvl
-  //interrupt disable to prevent screwups while inside sleep_list
-  while (!list_empty(&sleep_list))
-  {
-      // continuously check the front of the list
-      t = list_entry(list_front(&sleep_list), struct thread, sleepelem);
-      // Finished, all other elements are not ready
-      if (ticks < t->wakeup_time) break;
+/* Unblocks every thread in sleep_list whose wakeup time has
+   come.  Runs in a worker thread. */
+static void
+wake_sleepers (void *aux UNUSED)
+{
+  int64_t now = timer_ticks ();
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  while (!list_empty (&sleep_list))
+    {
+      struct thread *t = list_entry (list_front (&sleep_list),
+                                     struct thread, sleepelem);
+      if (t->wakeup_time > now)
+        break;
+      list_pop_front (&sleep_list);
       thread_unblock (t);
-      
-      list_pop_front(&sleep_list);
-  }
-  intr_set_level(old_state); // restore interrupt level
+    }
+  intr_set_level (old_level);
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -0,0 +1,238 @@
+#include "filesys/dcache.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+
+/* Directory entry cache.
+
+   Maps a (directory inode sector, name) pair to the sector of
+   the inode that the name refers to, so that repeated lookups of
+   the same name do not have to scan the directory on disk.
+   Failed lookups are cached too, as negative entries whose
+   sector is DCACHE_NEGATIVE.
+
+   The cache holds at most DCACHE_SIZE entries.  When it is
+   full, the least recently used entry is evicted.  Entries are
+   dropped by dir_add() and dir_remove() whenever the directory
+   contents they describe change. */
+
+/* Maximum number of cached entries. */
+#define DCACHE_SIZE 64
+
+/* A cached name lookup. */
+struct dcache_entry
+  {
+    struct hash_elem hash_elem;         /* Element in dcache_hash. */
+    struct list_elem lru_elem;          /* Element in lru_list. */
+    block_sector_t dir_sector;          /* Directory's inode sector. */
+    block_sector_t inode_sector;        /* Result, or DCACHE_NEGATIVE. */
+    char name[NAME_MAX + 1];            /* Null terminated file name. */
+  };
+
+/* Cached entries, hashed on directory sector and name. */
+static struct hash dcache_hash;
+
+/* Cached entries, most recently used first. */
+static struct list lru_list;
+
+/* Protects dcache_hash, lru_list and the statistics. */
+static struct lock dcache_lock;
+
+/* Statistics. */
+static unsigned long long hit_cnt;       /* Positive entries found. */
+static unsigned long long neg_hit_cnt;   /* Negative entries found. */
+static unsigned long long miss_cnt;      /* Lookups not in the cache. */
+static unsigned long long evict_cnt;     /* Entries evicted for space. */
+
+static hash_hash_func dcache_hash_func;
+static hash_less_func dcache_less_func;
+static struct dcache_entry *find_entry (block_sector_t, const char *);
+static void remove_entry (struct dcache_entry *);
+
+/* Initializes the directory entry cache. */
+void
+dcache_init (void)
+{
+  if (!hash_init (&dcache_hash, dcache_hash_func, dcache_less_func, NULL))
+    PANIC ("directory entry cache creation failed");
+  list_init (&lru_list);
+  lock_init (&dcache_lock);
+}
+
+/* Looks up NAME in the directory whose inode is in DIR_SECTOR.
+   If the cache knows the answer, returns true and stores the
+   inode sector into *INODE_SECTOR, or DCACHE_NEGATIVE if NAME is
+   known not to exist.  Returns false on a cache miss. */
+bool
+dcache_lookup (block_sector_t dir_sector, const char *name,
+               block_sector_t *inode_sector)
+{
+  struct dcache_entry *e;
+
+  ASSERT (name != NULL);
+  ASSERT (inode_sector != NULL);
+
+  lock_acquire (&dcache_lock);
+  e = find_entry (dir_sector, name);
+  if (e != NULL)
+    {
+      /* Move to the front of the LRU list. */
+      list_remove (&e->lru_elem);
+      list_push_front (&lru_list, &e->lru_elem);
+
+      *inode_sector = e->inode_sector;
+      if (e->inode_sector == DCACHE_NEGATIVE)
+        neg_hit_cnt++;
+      else
+        hit_cnt++;
+    }
+  else
+    miss_cnt++;
+  lock_release (&dcache_lock);
+
+  return e != NULL;
+}
+
+/* Records that NAME in the directory whose inode is in
+   DIR_SECTOR refers to INODE_SECTOR, or does not exist if
+   INODE_SECTOR is DCACHE_NEGATIVE.  Silently does nothing if
+   NAME is too long or memory is short. */
+void
+dcache_insert (block_sector_t dir_sector, const char *name,
+               block_sector_t inode_sector)
+{
+  struct dcache_entry *e;
+
+  ASSERT (name != NULL);
+
+  if (strlen (name) > NAME_MAX)
+    return;
+
+  lock_acquire (&dcache_lock);
+  e = find_entry (dir_sector, name);
+  if (e != NULL)
+    list_remove (&e->lru_elem);
+  else
+    {
+      /* Make room by evicting the least recently used entry. */
+      if (hash_size (&dcache_hash) >= DCACHE_SIZE)
+        {
+          remove_entry (list_entry (list_back (&lru_list),
+                                    struct dcache_entry, lru_elem));
+          evict_cnt++;
+        }
+
+      e = malloc (sizeof *e);
+      if (e == NULL)
+        {
+          lock_release (&dcache_lock);
+          return;
+        }
+      e->dir_sector = dir_sector;
+      strlcpy (e->name, name, sizeof e->name);
+      hash_insert (&dcache_hash, &e->hash_elem);
+    }
+  e->inode_sector = inode_sector;
+  list_push_front (&lru_list, &e->lru_elem);
+  lock_release (&dcache_lock);
+}
+
+/* Drops any cached entry for NAME in the directory whose inode
+   is in DIR_SECTOR. */
+void
+dcache_invalidate (block_sector_t dir_sector, const char *name)
+{
+  struct dcache_entry *e;
+
+  ASSERT (name != NULL);
+
+  lock_acquire (&dcache_lock);
+  e = find_entry (dir_sector, name);
+  if (e != NULL)
+    remove_entry (e);
+  lock_release (&dcache_lock);
+}
+
+/* Drops every cached entry for the directory whose inode is in
+   DIR_SECTOR, e.g. because that sector now holds a new
+   directory. */
+void
+dcache_invalidate_dir (block_sector_t dir_sector)
+{
+  struct list_elem *e, *next;
+
+  lock_acquire (&dcache_lock);
+  for (e = list_begin (&lru_list); e != list_end (&lru_list); e = next)
+    {
+      struct dcache_entry *de = list_entry (e, struct dcache_entry, lru_elem);
+      next = list_next (e);
+      if (de->dir_sector == dir_sector)
+        remove_entry (de);
+    }
+  lock_release (&dcache_lock);
+}
+
+/* Prints directory entry cache statistics. */
+void
+dcache_print_stats (void)
+{
+  printf ("Dcache: %llu hits, %llu negative hits, %llu misses, "
+          "%llu evictions\n", hit_cnt, neg_hit_cnt, miss_cnt, evict_cnt);
+}
+
+/* Returns the cached entry for NAME in DIR_SECTOR, or a null
+   pointer if there is none.  The caller must hold dcache_lock. */
+static struct dcache_entry *
+find_entry (block_sector_t dir_sector, const char *name)
+{
+  struct dcache_entry key;
+  struct hash_elem *e;
+
+  if (strlen (name) > NAME_MAX)
+    return NULL;
+
+  key.dir_sector = dir_sector;
+  strlcpy (key.name, name, sizeof key.name);
+  e = hash_find (&dcache_hash, &key.hash_elem);
+  return e != NULL ? hash_entry (e, struct dcache_entry, hash_elem) : NULL;
+}
+
+/* Removes E from the cache and frees it.
+   The caller must hold dcache_lock. */
+static void
+remove_entry (struct dcache_entry *e)
+{
+  hash_delete (&dcache_hash, &e->hash_elem);
+  list_remove (&e->lru_elem);
+  free (e);
+}
+
+/* Returns a hash value for the dcache_entry containing E. */
+static unsigned
+dcache_hash_func (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct dcache_entry *de
+    = hash_entry (e, struct dcache_entry, hash_elem);
+  return hash_string (de->name) ^ hash_int (de->dir_sector);
+}
+
+/* Returns true if the dcache_entry containing A precedes the one
+   containing B. */
+static bool
+dcache_less_func (const struct hash_elem *a, const struct hash_elem *b,
+                  void *aux UNUSED)
+{
+  const struct dcache_entry *x
+    = hash_entry (a, struct dcache_entry, hash_elem);
+  const struct dcache_entry *y
+    = hash_entry (b, struct dcache_entry, hash_elem);
+
+  if (x->dir_sector != y->dir_sector)
+    return x->dir_sector < y->dir_sector;
+  return strcmp (x->name, y->name) < 0;
+}
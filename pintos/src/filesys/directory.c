@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <list.h>
+#include "filesys/dcache.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
@@ -21,22 +22,67 @@ struct dir_entry
     bool in_use;                        /* In use or free? */
   };
 
+/* Number of directory entries read from disk at a time.  128
+   entries of 20 bytes fill exactly 5 sectors, so batches stay
+   sector aligned. */
+#define ENTRY_BATCH 128
+
+/* Reads up to CNT entries of directory INODE, starting at byte
+   offset OFS, into ENTRIES with a single inode_read_at().
+   Returns the number of entries read, which is 0 at the end of
+   the directory. */
+static size_t
+read_entries (struct inode *inode, off_t ofs, struct dir_entry *entries,
+              size_t cnt)
+{
+  return inode_read_at (inode, entries, cnt * sizeof *entries, ofs)
+         / sizeof *entries;
+}
+
+/* Returns a buffer for a batch of entries and stores its size in
+   entries into *CNT.  If memory is short, falls back to SPARE,
+   which holds a single entry.  Release with free_batch(). */
+static struct dir_entry *
+alloc_batch (struct dir_entry *spare, size_t *cnt)
+{
+  struct dir_entry *entries = malloc (ENTRY_BATCH * sizeof *entries);
+  if (entries != NULL)
+    {
+      *cnt = ENTRY_BATCH;
+      return entries;
+    }
+  *cnt = 1;
+  return spare;
+}
+
+/* Frees ENTRIES, obtained from alloc_batch() with SPARE. */
+static void
+free_batch (struct dir_entry *entries, struct dir_entry *spare)
+{
+  if (entries != spare)
+    free (entries);
+}
+
 /* Creates a directory with space for ENTRY_CNT entries in the
    given SECTOR.  Returns true if successful, false on failure. */
 bool
 dir_create (block_sector_t sector, size_t entry_cnt)
 {
+  /* SECTOR may have held a directory that was since removed. */
+  dcache_invalidate_dir (sector);
   return inode_create (sector, entry_cnt * sizeof (struct dir_entry));
 }
 
 /* Opens and returns the directory for the given INODE, of which
-   it takes ownership.  Returns a null pointer on failure. */
+   it takes ownership.  Directory contents are journaled as
+   metadata.  Returns a null pointer on failure. */
 struct dir *
 dir_open (struct inode *inode) 
 {
   struct dir *dir = calloc (1, sizeof *dir);
   if (inode != NULL && dir != NULL)
     {
+      inode_set_metadata (inode);
       dir->inode = inode;
       dir->pos = 0;
       return dir;
@@ -92,40 +138,64 @@ static bool
 lookup (const struct dir *dir, const char *name,
         struct dir_entry *ep, off_t *ofsp) 
 {
-  struct dir_entry e;
-  size_t ofs;
+  struct dir_entry spare, *entries;
+  size_t batch, cnt, i;
+  off_t ofs;
+  bool found = false;
   
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
-  for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-       ofs += sizeof e) 
-    if (e.in_use && !strcmp (name, e.name)) 
-      {
-        if (ep != NULL)
-          *ep = e;
-        if (ofsp != NULL)
-          *ofsp = ofs;
-        return true;
-      }
-  return false;
+  entries = alloc_batch (&spare, &batch);
+  for (ofs = 0;
+       !found && (cnt = read_entries (dir->inode, ofs, entries, batch)) > 0;
+       ofs += cnt * sizeof *entries)
+    for (i = 0; i < cnt; i++)
+      if (entries[i].in_use && !strcmp (name, entries[i].name)) 
+        {
+          if (ep != NULL)
+            *ep = entries[i];
+          if (ofsp != NULL)
+            *ofsp = ofs + i * sizeof *entries;
+          found = true;
+          break;
+        }
+  free_batch (entries, &spare);
+  return found;
 }
 
 /* Searches DIR for a file with the given NAME
    and returns true if one exists, false otherwise.
    On success, sets *INODE to an inode for the file, otherwise to
-   a null pointer.  The caller must close *INODE. */
+   a null pointer.  The caller must close *INODE.
+   Consults the directory entry cache first, and records the
+   result of any lookup that has to read the directory.  The
+   directory lock is held from the read to the cache insertion,
+   so that a concurrent dir_add() or dir_remove() cannot leave a
+   stale entry behind. */
 bool
 dir_lookup (const struct dir *dir, const char *name,
             struct inode **inode) 
 {
+  block_sector_t dir_sector;
+  block_sector_t inode_sector;
   struct dir_entry e;
 
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
-  if (lookup (dir, name, &e, NULL))
-    *inode = inode_open (e.inode_sector);
+  dir_sector = inode_get_inumber (dir->inode);
+  if (!dcache_lookup (dir_sector, name, &inode_sector))
+    {
+      lock_acquire (&dir->inode->dir_lock);
+      inode_sector = (lookup (dir, name, &e, NULL)
+                      ? e.inode_sector : DCACHE_NEGATIVE);
+      dcache_insert (dir_sector, name, inode_sector);
+      lock_release (&dir->inode->dir_lock);
+    }
+
+  if (inode_sector != DCACHE_NEGATIVE)
+    *inode = inode_open (inode_sector);
   else
     *inode = NULL;
 
@@ -137,11 +207,13 @@ dir_lookup (const struct dir *dir, const char *name,
    INODE_SECTOR.
    Returns true if successful, false on failure.
    Fails if NAME is invalid (i.e. too long) or a disk or memory
-   error occurs. */
+   error occurs.  Holds DIR's directory lock throughout, so that
+   concurrent adds cannot claim the same name or slot. */
 bool
 dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
 {
-  struct dir_entry e;
+  struct dir_entry e, *entries;
+  size_t batch, cnt, i;
   off_t ofs;
   bool success = false;
 
@@ -153,6 +225,7 @@ dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
     return false;
 
   /* Check that NAME is not in use. */
+  lock_acquire (&dir->inode->dir_lock);
   if (lookup (dir, name, NULL, NULL))
     goto done;
 
@@ -163,18 +236,30 @@ dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
      inode_read_at() will only return a short read at end of file.
      Otherwise, we'd need to verify that we didn't get a short
      read due to something intermittent such as low memory. */
-  for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-       ofs += sizeof e) 
-    if (!e.in_use)
-      break;
+  entries = alloc_batch (&e, &batch);
+  for (ofs = 0; (cnt = read_entries (dir->inode, ofs, entries, batch)) > 0;
+       ofs += i * sizeof *entries) 
+    {
+      for (i = 0; i < cnt; i++)
+        if (!entries[i].in_use)
+          break;
+      if (i < cnt)
+        {
+          ofs += i * sizeof *entries;
+          break;
+        }
+    }
+  free_batch (entries, &e);
 
-  /* Write slot. */
+  /* Write slot.  Drop any negative cache entry for NAME first. */
+  dcache_invalidate (inode_get_inumber (dir->inode), name);
   e.in_use = true;
   strlcpy (e.name, name, sizeof e.name);
   e.inode_sector = inode_sector;
   success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
 
  done:
+  lock_release (&dir->inode->dir_lock);
   return success;
 }
 
@@ -193,6 +278,7 @@ dir_remove (struct dir *dir, const char *name)
   ASSERT (name != NULL);
 
   /* Find directory entry. */
+  lock_acquire (&dir->inode->dir_lock);
   if (!lookup (dir, name, &e, &ofs))
     goto done;
 
@@ -202,6 +288,7 @@ dir_remove (struct dir *dir, const char *name)
     goto done;
 
   /* Erase directory entry. */
+  dcache_invalidate (inode_get_inumber (dir->inode), name);
   e.in_use = false;
   if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e) 
     goto done;
@@ -211,10 +298,61 @@ dir_remove (struct dir *dir, const char *name)
   success = true;
 
  done:
+  lock_release (&dir->inode->dir_lock);
   inode_close (inode);
   return success;
 }
 
+/* Stores up to CNT entries of DIR, starting from its current
+   position, into ENTRIES, reading the directory a batch of
+   entries at a time.  Advances DIR's position past the entries
+   returned, so that the next call resumes after them.  Returns
+   the number of entries stored, which is 0 once the end of the
+   directory is reached.  The root directory is the only one, so
+   every entry names a regular file. */
+size_t
+dir_getdents (struct dir *dir, struct dirent *entries, size_t cnt)
+{
+  struct dir_entry spare, *batch_buf;
+  size_t batch, n, i;
+  size_t stored = 0;
+
+  batch_buf = alloc_batch (&spare, &batch);
+  while (stored < cnt
+         && (n = read_entries (dir->inode, dir->pos, batch_buf, batch)) > 0)
+    for (i = 0; i < n && stored < cnt; i++)
+      {
+        struct dir_entry *e = &batch_buf[i];
+        dir->pos += sizeof *e;
+        if (e->in_use)
+          {
+            struct dirent *d = &entries[stored++];
+            d->d_ino = e->inode_sector;
+            d->d_type = DT_REG;
+            strlcpy (d->d_name, e->name, sizeof d->d_name);
+          }
+      }
+  free_batch (batch_buf, &spare);
+  return stored;
+}
+
+/* Sets DIR's position, in bytes from the start of the directory,
+   to POS. */
+void
+dir_seek (struct dir *dir, off_t pos)
+{
+  ASSERT (pos >= 0);
+  dir->pos = pos;
+}
+
+/* Returns DIR's position, in bytes from the start of the
+   directory. */
+off_t
+dir_tell (struct dir *dir)
+{
+  return dir->pos;
+}
+
 /* Reads the next directory entry in DIR and stores the name in
    NAME.  Returns true if successful, false if the directory
    contains no more entries. */
@@ -104,6 +104,17 @@ file_write_at (struct file *file, const void *buffer, off_t size,
   return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Reserves disk space for LENGTH bytes of FILE starting at
+   offset OFFSET, without writing them, and extends FILE to cover
+   them.  The reserved bytes read as zeros until written.
+   The file's current position is unaffected.
+   Returns true if successful, false on failure. */
+bool
+file_fallocate (struct file *file, off_t offset, off_t length)
+{
+  return inode_fallocate (file->inode, offset, length);
+}
+
 /* Prevents write operations on FILE's underlying inode
    until file_allow_write() is called or FILE is closed. */
 void
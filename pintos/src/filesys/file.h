@@ -24,6 +24,7 @@ off_t file_read (struct file *file, void *buffer, off_t size);
 off_t file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs);
 off_t file_write (struct file *file, const void *buffer, off_t size);
 off_t file_write_at (struct file *file, const void *buffer, off_t size, off_t file_ofs);
+bool file_fallocate (struct file *file, off_t offset, off_t length);
 
 /* Preventing writes. */
 void file_deny_write (struct file *file);
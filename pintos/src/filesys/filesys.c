@@ -2,10 +2,12 @@
 #include <debug.h>
 #include <stdio.h>
 #include <string.h>
+#include "filesys/dcache.h"
 #include "filesys/file.h"
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
+#include "filesys/journal.h"
 
 /* Partition that contains the file system. */
 struct block *fs_device;
@@ -22,6 +24,8 @@ filesys_init (bool format)
     PANIC ("No file system device found, can't initialize file system.");
 
   inode_init ();
+  dcache_init ();
+  journal_init (format);
   free_map_init ();
 
   if (format) 
@@ -35,10 +39,14 @@ filesys_init (bool format)
 void
 filesys_done (void) 
 {
+  journal_begin ();
   free_map_close ();
+  journal_end ();
+  journal_sync ();
 }
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
+   The metadata changes form a single journal operation.
    Returns true if successful, false otherwise.
    Fails if a file named NAME already exists,
    or if internal memory allocation fails. */
@@ -46,19 +54,27 @@ bool
 filesys_create (const char *name, off_t initial_size) 
 {
   block_sector_t inode_sector = 0;
-  struct dir *dir = dir_open_root ();
-  bool success = (dir != NULL
-                  && free_map_allocate (1, &inode_sector)
-                  && inode_create (inode_sector, initial_size)
-                  && dir_add (dir, name, inode_sector));
+  struct dir *dir;
+  bool success;
+
+  journal_begin ();
+  dir = dir_open_root ();
+  success = (dir != NULL
+             && free_map_allocate (1, inode_get_inumber (dir_get_inode (dir)),
+                                   &inode_sector)
+             && inode_create (inode_sector, initial_size)
+             && dir_add (dir, name, inode_sector));
   if (!success && inode_sector != 0) 
     free_map_release (inode_sector, 1);
   dir_close (dir);
+  free_map_flush ();
+  journal_end ();
 
   return success;
 }
 
-/* Opens the file with the given NAME.
+/* Opens the file with the given NAME.  "/" and "." name the root
+   directory itself, which can then be listed with dir_getdents().
    Returns the new file if successful or a null pointer
    otherwise.
    Fails if no file named NAME exists,
@@ -67,8 +83,18 @@ struct file *
 filesys_open (const char *name)
 {
   bool exists = false;
-  struct dir *dir = dir_open_root ();
+  struct dir *dir;
   struct inode *inode = NULL;
+
+  if (!strcmp (name, "/") || !strcmp (name, "."))
+    {
+      inode = inode_open (ROOT_DIR_SECTOR);
+      if (inode != NULL)
+        inode_set_metadata (inode);
+      return file_open (inode);
+    }
+
+  dir = dir_open_root ();
   if (dir != NULL)
     exists = dir_lookup (dir, name, &inode);
 
@@ -81,15 +107,22 @@ filesys_open (const char *name)
 }
 
 /* Deletes the file named NAME.
+   The metadata changes form a single journal operation.
    Returns true if successful, false on failure.
    Fails if no file named NAME exists,
    or if an internal memory allocation fails. */
 bool
 filesys_remove (const char *name) 
 {
-  struct dir *dir = dir_open_root ();
-  bool success = dir != NULL && dir_remove (dir, name);
+  struct dir *dir;
+  bool success;
+
+  journal_begin ();
+  dir = dir_open_root ();
+  success = dir != NULL && dir_remove (dir, name);
   dir_close (dir); 
+  free_map_flush ();
+  journal_end ();
 
   return success;
 }
@@ -1,52 +1,328 @@
 #include "filesys/free-map.h"
 #include <bitmap.h>
 #include <debug.h>
+#include <round.h>
+#include <stdio.h>
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
+#include "threads/cpu.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per sector. */
 
+/* Protects the free map, the dirty map, the allocation groups,
+   and the statistics below.
+
+   free_map_flush() holds it while it writes the free map file,
+   so that no allocation changes a sector while it is being
+   written.  That write never allocates, because every sector of
+   the free map file is allocated when the file is created, so it
+   cannot come back into free_map_allocate() and deadlock. */
+static struct lock free_map_lock;
+
+/* Sectors of the free map file that have changed since they were
+   last written, one bit per free map file sector.  Only these are
+   written back by free_map_flush(). */
+static struct bitmap *dirty_map;
+
+/* Number of free map file sectors written back, and number of
+   flushes that wrote any. */
+static unsigned long long write_cnt;
+static unsigned long long flush_cnt;
+
+/* Number of free map bits stored in one free map file sector. */
+#define BITS_PER_SECTOR (BLOCK_SECTOR_SIZE * 8)
+
+/* Allocation groups.
+
+   The disk is divided into groups of GROUP_SECTORS consecutive
+   sectors.  Each group keeps a count of its free sectors, so
+   that full groups can be skipped without scanning the bitmap,
+   and a next-fit cursor, so that successive allocations within a
+   group continue where the last one ended instead of rescanning
+   the allocated sectors at its start.
+
+   Allocations start in the group that contains the caller's
+   locality hint, so that a file's data lands near its inode and
+   an inode near its directory.  Large allocations instead start
+   in the group with the most free space, so that they do not
+   fragment the groups that small files cluster in. */
+#define GROUP_SECTORS 1024
+
+/* Allocations of at least this many sectors are "large". */
+#define LARGE_ALLOC_SECTORS (GROUP_SECTORS / 4)
+
+struct alloc_group
+  {
+    size_t free_cnt;            /* Number of free sectors. */
+    block_sector_t cursor;      /* Where the next scan starts. */
+  };
+
+static struct alloc_group *groups;   /* Allocation groups. */
+static size_t group_cnt;             /* Number of allocation groups. */
+
+/* End of the last allocation, where a file written in order
+   continues contiguously. */
+static block_sector_t last_end;
+
+/* Statistics. */
+static unsigned long long alloc_cnt;    /* Successful allocations. */
+static unsigned long long contig_cnt;   /* Allocations at last_end. */
+static unsigned long long scan_cnt;     /* Bitmap positions examined. */
+static uint64_t alloc_cycles;           /* Time spent allocating. */
+
+static void mark_dirty (block_sector_t, size_t);
+static void init_groups (void);
+static void count_group_change (block_sector_t, size_t, bool allocated);
+static block_sector_t scan_group (size_t group, size_t cnt);
+static block_sector_t scan_range (block_sector_t start, block_sector_t end,
+                                  size_t cnt);
+
 /* Initializes the free map. */
 void
 free_map_init (void) 
 {
+  lock_init (&free_map_lock);
   free_map = bitmap_create (block_size (fs_device));
   if (free_map == NULL)
     PANIC ("bitmap creation failed--file system device is too large");
+  dirty_map = bitmap_create (DIV_ROUND_UP (bitmap_file_size (free_map),
+                                           BLOCK_SECTOR_SIZE));
+  if (dirty_map == NULL)
+    PANIC ("bitmap creation failed--file system device is too large");
+  group_cnt = DIV_ROUND_UP (bitmap_size (free_map), GROUP_SECTORS);
+  groups = malloc (group_cnt * sizeof *groups);
+  if (groups == NULL)
+    PANIC ("allocation group creation failed");
   bitmap_mark (free_map, FREE_MAP_SECTOR);
   bitmap_mark (free_map, ROOT_DIR_SECTOR);
+  bitmap_set_multiple (free_map, JOURNAL_SECTOR, JOURNAL_SECTORS, true);
+  init_groups ();
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
-   the first into *SECTORP.
+   the first into *SECTORP.  The sectors are placed as close as
+   possible after HINT, typically the sector of a related inode.
    Returns true if successful, false if not enough consecutive
-   sectors were available or if the free_map file could not be
-   written. */
+   sectors were available.
+   The change reaches disk at the next free_map_flush(). */
 bool
-free_map_allocate (size_t cnt, block_sector_t *sectorp)
+free_map_allocate (size_t cnt, block_sector_t hint, block_sector_t *sectorp)
 {
-  block_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
-  if (sector != BITMAP_ERROR
-      && free_map_file != NULL
-      && !bitmap_write (free_map, free_map_file))
+  block_sector_t sector = BITMAP_ERROR;
+  uint64_t start;
+  size_t first, i;
+
+  if (cnt == 0)
     {
-      bitmap_set_multiple (free_map, sector, cnt, false); 
-      sector = BITMAP_ERROR;
+      *sectorp = 0;
+      return true;
     }
+  lock_acquire (&free_map_lock);
+  start = rdtsc ();
+
+  /* Pick the group to start in. */
+  if (cnt >= LARGE_ALLOC_SECTORS)
+    {
+      first = 0;
+      for (i = 1; i < group_cnt; i++)
+        if (groups[i].free_cnt > groups[first].free_cnt)
+          first = i;
+    }
+  else
+    first = hint < bitmap_size (free_map) ? hint / GROUP_SECTORS : 0;
+
+  /* Try each group in turn, starting from FIRST.  A run longer
+     than a group, or one that only fits across a group boundary,
+     falls back to scanning the whole disk. */
+  if (cnt <= GROUP_SECTORS)
+    for (i = 0; i < group_cnt && sector == BITMAP_ERROR; i++)
+      {
+        size_t group = (first + i) % group_cnt;
+        if (groups[group].free_cnt >= cnt)
+          sector = scan_group (group, cnt);
+      }
+  if (sector == BITMAP_ERROR)
+    sector = scan_range (0, bitmap_size (free_map), cnt);
+
   if (sector != BITMAP_ERROR)
-    *sectorp = sector;
+    {
+      struct alloc_group *g = &groups[sector / GROUP_SECTORS];
+      block_sector_t next = sector + cnt;
+
+      bitmap_set_multiple (free_map, sector, cnt, true);
+      count_group_change (sector, cnt, true);
+      g->cursor = next / GROUP_SECTORS == sector / GROUP_SECTORS
+                  ? next : sector / GROUP_SECTORS * GROUP_SECTORS;
+      mark_dirty (sector, cnt);
+      alloc_cnt++;
+      if (sector == last_end)
+        contig_cnt++;
+      last_end = next;
+      *sectorp = sector;
+    }
+  alloc_cycles += rdtsc () - start;
+  lock_release (&free_map_lock);
   return sector != BITMAP_ERROR;
 }
 
-/* Makes CNT sectors starting at SECTOR available for use. */
+/* Makes CNT sectors starting at SECTOR available for use.
+   The change reaches disk at the next free_map_flush(). */
 void
 free_map_release (block_sector_t sector, size_t cnt)
 {
+  lock_acquire (&free_map_lock);
   ASSERT (bitmap_all (free_map, sector, cnt));
   bitmap_set_multiple (free_map, sector, cnt, false);
-  bitmap_write (free_map, free_map_file);
+  count_group_change (sector, cnt, false);
+  mark_dirty (sector, cnt);
+  lock_release (&free_map_lock);
+}
+
+/* Writes the free map file sectors changed since the last flush
+   back to disk.  Returns true if successful, false if any write
+   failed, in which case the failed sectors stay dirty. */
+bool
+free_map_flush (void)
+{
+  bool success = true;
+  size_t i;
+
+  if (free_map_file == NULL)
+    return true;
+
+  lock_acquire (&free_map_lock);
+  if (bitmap_none (dirty_map, 0, bitmap_size (dirty_map)))
+    {
+      lock_release (&free_map_lock);
+      return true;
+    }
+  for (i = 0; i < bitmap_size (dirty_map); i++)
+    if (bitmap_test (dirty_map, i))
+      {
+        if (bitmap_write_range (free_map, free_map_file,
+                                i * BLOCK_SECTOR_SIZE, BLOCK_SECTOR_SIZE))
+          {
+            bitmap_reset (dirty_map, i);
+            write_cnt++;
+          }
+        else
+          success = false;
+      }
+  flush_cnt++;
+  lock_release (&free_map_lock);
+  return success;
+}
+
+/* Prints free map statistics.  Called at power off, when
+   nothing else is using the free map, so it takes no lock. */
+void
+free_map_print_stats (void)
+{
+  printf ("Free map: %llu allocations, %llu contiguous, "
+          "%llu positions scanned, %"PRIu64" cycles per allocation\n",
+          alloc_cnt, contig_cnt, scan_cnt,
+          alloc_cnt > 0 ? alloc_cycles / alloc_cnt : 0);
+  printf ("Free map: %llu sectors written back in %llu flushes, "
+          "%zu sectors long\n", write_cnt, flush_cnt,
+          dirty_map != NULL ? bitmap_size (dirty_map) : 0);
+}
+
+/* Recomputes every allocation group's free count from the free
+   map and rewinds its cursor. */
+static void
+init_groups (void)
+{
+  size_t i;
+
+  for (i = 0; i < group_cnt; i++)
+    {
+      block_sector_t start = i * GROUP_SECTORS;
+      size_t size = bitmap_size (free_map) - start;
+      if (size > GROUP_SECTORS)
+        size = GROUP_SECTORS;
+      groups[i].free_cnt = bitmap_count (free_map, start, size, false);
+      groups[i].cursor = start;
+    }
+}
+
+/* Updates the free counts of the allocation groups spanned by
+   the CNT sectors starting at SECTOR, which were just ALLOCATED
+   or, if false, released. */
+static void
+count_group_change (block_sector_t sector, size_t cnt, bool allocated)
+{
+  while (cnt > 0)
+    {
+      struct alloc_group *g = &groups[sector / GROUP_SECTORS];
+      size_t chunk = GROUP_SECTORS - sector % GROUP_SECTORS;
+      if (chunk > cnt)
+        chunk = cnt;
+
+      if (allocated)
+        {
+          ASSERT (g->free_cnt >= chunk);
+          g->free_cnt -= chunk;
+        }
+      else
+        g->free_cnt += chunk;
+
+      sector += chunk;
+      cnt -= chunk;
+    }
+}
+
+/* Searches allocation group GROUP for CNT consecutive free
+   sectors, starting at its cursor and wrapping around to its
+   start.  Returns the first sector of the run, or BITMAP_ERROR
+   if the group has no such run. */
+static block_sector_t
+scan_group (size_t group, size_t cnt)
+{
+  block_sector_t start = group * GROUP_SECTORS;
+  block_sector_t end = start + GROUP_SECTORS;
+  block_sector_t cursor = groups[group].cursor;
+  block_sector_t sector;
+
+  if (end > bitmap_size (free_map))
+    end = bitmap_size (free_map);
+
+  sector = scan_range (cursor, end, cnt);
+  if (sector == BITMAP_ERROR && cursor > start)
+    sector = scan_range (start,
+                         cursor + cnt - 1 < end ? cursor + cnt - 1 : end,
+                         cnt);
+  return sector;
+}
+
+/* Searches sectors START...END (exclusive) for CNT consecutive
+   free sectors.  Returns the first sector of the run, or
+   BITMAP_ERROR if there is none. */
+static block_sector_t
+scan_range (block_sector_t start, block_sector_t end, size_t cnt)
+{
+  block_sector_t sector = bitmap_scan_range (free_map, start, end, cnt,
+                                             false);
+  scan_cnt += (sector != BITMAP_ERROR ? sector + cnt : end) - start;
+  return sector;
+}
+
+/* Marks the free map file sectors holding the bits for the CNT
+   sectors starting at SECTOR as dirty. */
+static void
+mark_dirty (block_sector_t sector, size_t cnt)
+{
+  size_t first, last;
+
+  if (cnt == 0)
+    return;
+  first = sector / BITS_PER_SECTOR;
+  last = (sector + cnt - 1) / BITS_PER_SECTOR;
+  bitmap_set_multiple (dirty_map, first, last - first + 1, true);
 }
 
 /* Opens the free map file and reads it from disk. */
@@ -56,15 +332,20 @@ free_map_open (void)
   free_map_file = file_open (inode_open (FREE_MAP_SECTOR));
   if (free_map_file == NULL)
     PANIC ("can't open free map");
+  inode_set_metadata (file_get_inode (free_map_file));
   if (!bitmap_read (free_map, free_map_file))
     PANIC ("can't read free map");
+  init_groups ();
 }
 
 /* Writes the free map to disk and closes the free map file. */
 void
 free_map_close (void) 
 {
+  if (!free_map_flush ())
+    printf ("free map: write back failed\n");
   file_close (free_map_file);
+  free_map_file = NULL;
 }
 
 /* Creates a new free map file on disk and writes the free map to
@@ -80,6 +361,11 @@ free_map_create (void)
   free_map_file = file_open (inode_open (FREE_MAP_SECTOR));
   if (free_map_file == NULL)
     PANIC ("can't open free map");
+  inode_set_metadata (file_get_inode (free_map_file));
   if (!bitmap_write (free_map, free_map_file))
     PANIC ("can't write free map");
+
+  /* The file's own sectors were allocated while it was being
+     written, so some sectors already written may be stale.  They
+     are still marked dirty and go out at the next flush. */
 }
@@ -1,9 +1,11 @@
 #include "filesys/fsutil.h"
 #include <debug.h>
+#include <round.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ustar.h>
+#include "devices/timer.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
@@ -67,6 +69,9 @@ fsutil_rm (char **argv)
     PANIC ("%s: delete failed\n", file_name);
 }
 
+/* Sectors copied by each read and write of fsutil_extract(). */
+#define EXTRACT_CHUNK_SECTORS 64
+
 /* Extracts a ustar-format tar archive from the scratch block
    device into the Pintos file system. */
 void
@@ -79,7 +84,7 @@ fsutil_extract (char **argv UNUSED)
 
   /* Allocate buffers. */
   header = malloc (BLOCK_SECTOR_SIZE);
-  data = malloc (BLOCK_SECTOR_SIZE);
+  data = malloc (EXTRACT_CHUNK_SECTORS * BLOCK_SECTOR_SIZE);
   if (header == NULL || data == NULL)
     PANIC ("couldn't allocate buffers");
 
@@ -117,20 +122,25 @@ fsutil_extract (char **argv UNUSED)
 
           printf ("Putting '%s' into the file system...\n", file_name);
 
-          /* Create destination file. */
+          /* Create destination file and reserve its space, so
+             that its data is laid out consecutively. */
           if (!filesys_create (file_name, size))
             PANIC ("%s: create failed", file_name);
           dst = filesys_open (file_name);
           if (dst == NULL)
             PANIC ("%s: open failed", file_name);
+          if (!file_fallocate (dst, 0, size))
+            PANIC ("%s: fallocate failed", file_name);
 
-          /* Do copy. */
+          /* Do copy, many sectors at a time. */
           while (size > 0)
             {
-              int chunk_size = (size > BLOCK_SECTOR_SIZE
-                                ? BLOCK_SECTOR_SIZE
-                                : size);
-              block_read (src, sector++, data);
+              int max_chunk = EXTRACT_CHUNK_SECTORS * BLOCK_SECTOR_SIZE;
+              int chunk_size = size > max_chunk ? max_chunk : size;
+              block_sector_t cnt = DIV_ROUND_UP (chunk_size,
+                                                 BLOCK_SECTOR_SIZE);
+              block_read_multiple (src, sector, cnt, data);
+              sector += cnt;
               if (file_write (dst, data, chunk_size) != chunk_size)
                 PANIC ("%s: write failed with %d bytes unwritten",
                        file_name, size);
@@ -221,3 +231,56 @@ fsutil_append (char **argv)
   file_close (src);
   free (buffer);
 }
+
+/* Bytes read by fsutil_bench(), and bytes per read request. */
+#define BENCH_BYTES (8 * 1024 * 1024)
+#define BENCH_CHUNK (64 * 1024)
+
+/* Reads block device ARGV[1] sequentially, up to BENCH_BYTES
+   bytes of it, in requests of BENCH_CHUNK bytes, and prints the
+   resulting throughput. */
+void
+fsutil_bench (char **argv)
+{
+  const char *bdev_name = argv[1];
+  block_sector_t chunk_sectors = BENCH_CHUNK / BLOCK_SECTOR_SIZE;
+  block_sector_t sector, sector_cnt;
+  struct block *block;
+  int64_t start, ticks;
+  void *buffer;
+
+  block = block_get_by_name (bdev_name);
+  if (block == NULL)
+    PANIC ("%s: no such block device", bdev_name);
+  buffer = palloc_get_multiple (PAL_ASSERT, BENCH_CHUNK / PGSIZE);
+
+  sector_cnt = block_size (block);
+  if (sector_cnt > BENCH_BYTES / BLOCK_SECTOR_SIZE)
+    sector_cnt = BENCH_BYTES / BLOCK_SECTOR_SIZE;
+
+  printf ("Reading %"PRDSNu" kB from %s...\n",
+          sector_cnt / 2, bdev_name);
+  start = timer_ticks ();
+  for (sector = 0; sector < sector_cnt; sector += chunk_sectors)
+    {
+      block_sector_t n = sector_cnt - sector < chunk_sectors
+                         ? sector_cnt - sector : chunk_sectors;
+      block_read_multiple (block, sector, n, buffer);
+    }
+  ticks = timer_elapsed (start);
+
+  printf ("%s: read %"PRDSNu" kB in %"PRId64" ticks", bdev_name,
+          sector_cnt / 2, ticks);
+  if (ticks > 0)
+    printf (" (%"PRId64" kB/s)",
+            (int64_t) sector_cnt / 2 * TIMER_FREQ / ticks);
+  printf ("\n");
+  palloc_free_multiple (buffer, BENCH_CHUNK / PGSIZE);
+}
+
+/* Prints I/O statistics for every block device. */
+void
+fsutil_iostat (char **argv UNUSED)
+{
+  block_print_iostat ();
+}
@@ -1,55 +1,313 @@
 #include "filesys/inode.h"
 #include <list.h>
 #include <debug.h>
-#include <round.h>
+#include <stdio.h>
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "filesys/journal.h"
 #include "threads/malloc.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+/* Number of sector pointers in an indirect sector. */
+#define PTRS_PER_SECTOR (BLOCK_SECTOR_SIZE / sizeof (block_sector_t))
 
-/* Returns the number of sectors to allocate for an inode SIZE
-   bytes long. */
-static inline size_t
-bytes_to_sectors (off_t size)
+/* Largest number of data sectors an inode can address. */
+#define INODE_MAX_SECTORS (INODE_DIRECT_CNT + PTRS_PER_SECTOR \
+                           + PTRS_PER_SECTOR * PTRS_PER_SECTOR)
+
+/* Largest file size in bytes. */
+#define INODE_MAX_LENGTH ((off_t) (INODE_MAX_SECTORS * BLOCK_SECTOR_SIZE))
+
+/* Sectors that a write may allocate in a single journal
+   operation.  Bounds the metadata that one operation dirties to
+   the inode, at most two indirect sectors, the doubly indirect
+   sector and the free map sectors covering the allocations. */
+#define WRITE_BATCH_SECTORS 64
+
+/* A sector of zeros, for initializing new indirect sectors. */
+static char zeros[BLOCK_SECTOR_SIZE];
+
+/* List of open inodes, so that opening a single inode twice
+   returns the same `struct inode'. */
+static struct list open_inodes;
+
+/* Protects open_inodes and the open_cnt of each inode in it. */
+static struct lock open_inodes_lock;
+
+/* Most readers that have held a closed inode's rwlock at once.
+   Protected by open_inodes_lock. */
+static int peak_reader_cnt;
+
+/* Copies of the indirect sectors last used to look up an inode's
+   data sectors: slot 0 holds a doubly indirect sector and slot 1
+   an indirect sector at either level.  Walking a run of data
+   sectors through a cache reads each indirect sector once instead
+   of once per data sector.
+
+   A cache belongs to a single read, write or fallocate call, and
+   is only valid while the caller holds the inode's lock, so every
+   change to a cached sector during that time goes through it.
+   Callers start with a null pointer to one, which the lookup
+   functions allocate the first time they need it. */
+struct index_cache
+  {
+    block_sector_t sectors[2];                  /* Cached sectors, 0 if none. */
+    block_sector_t ptrs[2][PTRS_PER_SECTOR];    /* Their contents. */
+  };
+
+/* Writes BUFFER to data sector SECTOR of INODE, through the
+   journal if INODE holds metadata. */
+static void
+write_sector (struct inode *inode, block_sector_t sector, const void *buffer)
 {
-  return DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE);
+  if (inode->metadata)
+    journal_write (sector, buffer);
+  else
+    journal_write_data (sector, buffer);
 }
 
+/* Allocates a sector for INODE and stores it into *SECTORP.
+   If INDEX is true, the sector will hold sector pointers and is
+   initialized to all zeros; a new data sector is left as is,
+   because the caller is about to write it.  Returns true if
+   successful, false if the disk is full. */
+static bool
+allocate_sector (struct inode *inode, bool index, block_sector_t *sectorp)
+{
+  if (!free_map_allocate (1, inode->sector, sectorp))
+    return false;
+  if (index)
+    journal_write (*sectorp, zeros);
+  return true;
+}
 
-/* Returns the block device sector that contains byte offset POS
-   within INODE.
-   Returns -1 if INODE does not contain data for a byte at offset
-   POS. */
+/* Returns the sector stored in *SLOT, which is part of INODE's
+   on-disk inode.  If the slot is empty and ALLOCATE is true,
+   allocates a sector as with allocate_sector(), stores it in the
+   slot and writes the inode back.  Returns 0 for a hole. */
 static block_sector_t
-byte_to_sector (const struct inode *inode, off_t pos) 
+lookup_direct (struct inode *inode, block_sector_t *slot, bool allocate,
+               bool index)
 {
-  ASSERT (inode != NULL);
-  if (pos < inode->data.length)
-    return inode->data.start + pos / BLOCK_SECTOR_SIZE;
-  else
-    return -1;
+  if (*slot == 0 && allocate && allocate_sector (inode, index, slot))
+    journal_write (inode->sector, &inode->data);
+  return *slot;
 }
 
-/* List of open inodes, so that opening a single inode twice
-   returns the same `struct inode'. */
-static struct list open_inodes;
+/* Returns the pointers in indirect sector BLOCK, reading them
+   into slot LEVEL of *CACHE unless they are already there.
+   Allocates *CACHE if it is null.  Returns a null pointer if
+   memory is short. */
+static block_sector_t *
+read_indirect (struct index_cache **cache, int level, block_sector_t block)
+{
+  struct index_cache *c = *cache;
+
+  if (c == NULL)
+    {
+      c = *cache = calloc (1, sizeof *c);
+      if (c == NULL)
+        return NULL;
+    }
+  if (c->sectors[level] != block)
+    {
+      journal_read (block, c->ptrs[level]);
+      c->sectors[level] = block;
+    }
+  return c->ptrs[level];
+}
+
+/* Returns pointer IDX within indirect sector BLOCK of INODE,
+   looked up through slot LEVEL of *CACHE, allocating it as with
+   lookup_direct() if it is empty and ALLOCATE is true.  Returns 0
+   for a hole. */
+static block_sector_t
+lookup_indirect (struct inode *inode, struct index_cache **cache, int level,
+                 block_sector_t block, size_t idx, bool allocate, bool index)
+{
+  block_sector_t *ptrs;
+  block_sector_t sector;
+
+  if (block == 0)
+    return 0;
+
+  ptrs = read_indirect (cache, level, block);
+  if (ptrs == NULL)
+    return 0;
+  sector = ptrs[idx];
+  if (sector == 0 && allocate && allocate_sector (inode, index, &sector))
+    {
+      ptrs[idx] = sector;
+      journal_write (block, ptrs);
+    }
+  return sector;
+}
+
+/* Returns the device sector holding data sector IDX of INODE,
+   or 0 if that part of INODE is a hole, reading indirect sectors
+   through *CACHE.  If ALLOCATE is true, fills in the hole, and
+   any missing indirect sectors on the way to it, returning 0
+   only if the disk is full. */
+static block_sector_t
+index_to_sector (struct inode *inode, size_t idx, bool allocate,
+                 struct index_cache **cache)
+{
+  struct inode_disk *d = &inode->data;
+  block_sector_t block;
+
+  ASSERT (idx < INODE_MAX_SECTORS);
+
+  if (idx < INODE_DIRECT_CNT)
+    return lookup_direct (inode, &d->direct[idx], allocate, false);
+  idx -= INODE_DIRECT_CNT;
+
+  if (idx < PTRS_PER_SECTOR)
+    {
+      block = lookup_direct (inode, &d->indirect, allocate, true);
+      return lookup_indirect (inode, cache, 1, block, idx, allocate, false);
+    }
+  idx -= PTRS_PER_SECTOR;
+
+  block = lookup_direct (inode, &d->doubly_indirect, allocate, true);
+  block = lookup_indirect (inode, cache, 0, block, idx / PTRS_PER_SECTOR,
+                           allocate, true);
+  return lookup_indirect (inode, cache, 1, block, idx % PTRS_PER_SECTOR,
+                          allocate, false);
+}
+
+/* Stores VALUE into pointer IDX within indirect sector BLOCK,
+   through slot 1 of *CACHE.  Returns true if successful, false
+   if memory is short. */
+static bool
+store_indirect (struct index_cache **cache, block_sector_t block, size_t idx,
+                block_sector_t value)
+{
+  block_sector_t *ptrs = read_indirect (cache, 1, block);
+  if (ptrs == NULL)
+    return false;
+  ptrs[idx] = value;
+  journal_write (block, ptrs);
+  return true;
+}
+
+/* Stores VALUE as the pointer to data sector IDX of INODE,
+   allocating any missing indirect sectors on the way to it and
+   reading them through *CACHE.  Returns true if successful,
+   false if memory or disk space is short. */
+static bool
+set_sector (struct inode *inode, size_t idx, block_sector_t value,
+            struct index_cache **cache)
+{
+  struct inode_disk *d = &inode->data;
+  block_sector_t block;
+
+  ASSERT (idx < INODE_MAX_SECTORS);
+
+  if (idx < INODE_DIRECT_CNT)
+    {
+      d->direct[idx] = value;
+      journal_write (inode->sector, d);
+      return true;
+    }
+  idx -= INODE_DIRECT_CNT;
+
+  if (idx < PTRS_PER_SECTOR)
+    {
+      block = lookup_direct (inode, &d->indirect, true, true);
+      return block != 0 && store_indirect (cache, block, idx, value);
+    }
+  idx -= PTRS_PER_SECTOR;
+
+  block = lookup_direct (inode, &d->doubly_indirect, true, true);
+  block = lookup_indirect (inode, cache, 0, block, idx / PTRS_PER_SECTOR,
+                           true, true);
+  return block != 0 && store_indirect (cache, block, idx % PTRS_PER_SECTOR,
+                                       value);
+}
+
+/* Releases every nonzero sector pointer in indirect sector
+   BLOCK, recursing LEVELS further levels, then BLOCK itself. */
+static void
+release_indirect (block_sector_t block, int levels)
+{
+  block_sector_t *ptrs;
+  size_t i;
+
+  if (block == 0)
+    return;
+
+  ptrs = malloc (BLOCK_SECTOR_SIZE);
+  if (ptrs != NULL)
+    {
+      journal_read (block, ptrs);
+      for (i = 0; i < PTRS_PER_SECTOR; i++)
+        if (ptrs[i] != 0)
+          {
+            if (levels > 0)
+              release_indirect (ptrs[i], levels - 1);
+            else
+              free_map_release (ptrs[i] & ~INODE_UNWRITTEN, 1);
+          }
+      free (ptrs);
+    }
+  free_map_release (block, 1);
+}
+
+/* Releases all the sectors allocated to INODE's data. */
+static void
+release_sectors (struct inode *inode)
+{
+  struct inode_disk *d = &inode->data;
+  size_t i;
+
+  if (d->flags & INODE_INLINE)
+    return;
+  for (i = 0; i < INODE_DIRECT_CNT; i++)
+    if (d->direct[i] != 0)
+      free_map_release (d->direct[i] & ~INODE_UNWRITTEN, 1);
+  release_indirect (d->indirect, 0);
+  release_indirect (d->doubly_indirect, 1);
+}
 
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
   list_init (&open_inodes);
+  lock_init (&open_inodes_lock);
+}
+
+/* Prints inode statistics: the most readers that any inode has
+   had at once, which is greater than 1 only if readers of a file
+   overlapped. */
+void
+inode_print_stats (void)
+{
+  struct list_elem *e;
+  int peak = peak_reader_cnt;
+
+  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
+       e = list_next (e))
+    {
+      struct inode *inode = list_entry (e, struct inode, elem);
+      if (inode->rwlock.peak_reader_cnt > peak)
+        peak = inode->rwlock.peak_reader_cnt;
+    }
+  printf ("Inode: at most %d readers at once\n", peak);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
    writes the new inode to sector SECTOR on the file system
-   device.
+   device.  No data sectors are allocated: a file of at most
+   INODE_INLINE_MAX bytes starts out with its zeroed data inline,
+   and a larger one starts out as a hole, which reads as zeros,
+   whose sectors are allocated as they are first written.
    Returns true if successful.
-   Returns false if memory or disk allocation fails. */
+   Returns false if memory allocation fails or LENGTH is too
+   large. */
 bool
 inode_create (block_sector_t sector, off_t length)
 {
@@ -62,25 +320,18 @@ inode_create (block_sector_t sector, off_t length)
      one sector in size, and you should fix that. */
   ASSERT (sizeof *disk_inode == BLOCK_SECTOR_SIZE);
 
+  if (length > INODE_MAX_LENGTH)
+    return false;
+
   disk_inode = calloc (1, sizeof *disk_inode);
   if (disk_inode != NULL)
     {
-      size_t sectors = bytes_to_sectors (length);
       disk_inode->length = length;
+      if ((size_t) length <= INODE_INLINE_MAX)
+        disk_inode->flags = INODE_INLINE;
       disk_inode->magic = INODE_MAGIC;
-      if (free_map_allocate (sectors, &disk_inode->start)) 
-        {
-          block_write (fs_device, sector, disk_inode);
-          if (sectors > 0) 
-            {
-              static char zeros[BLOCK_SECTOR_SIZE];
-              size_t i;
-              
-              for (i = 0; i < sectors; i++) 
-                block_write (fs_device, disk_inode->start + i, zeros);
-            }
-          success = true; 
-        } 
+      journal_write (sector, disk_inode);
+      success = true; 
       free (disk_inode);
     }
   return success;
@@ -96,13 +347,15 @@ inode_open (block_sector_t sector)
   struct inode *inode;
 
   /* Check whether this inode is already open. */
+  lock_acquire (&open_inodes_lock);
   for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
        e = list_next (e)) 
     {
       inode = list_entry (e, struct inode, elem);
       if (inode->sector == sector) 
         {
-          inode_reopen (inode);
+          inode->open_cnt++;
+          lock_release (&open_inodes_lock);
           return inode; 
         }
     }
@@ -110,15 +363,23 @@ inode_open (block_sector_t sector)
   /* Allocate memory. */
   inode = malloc (sizeof *inode);
   if (inode == NULL)
-    return NULL;
+    {
+      lock_release (&open_inodes_lock);
+      return NULL;
+    }
 
-  /* Initialize. */
+  /* Initialize.  The inode is read before releasing the lock, so
+     that a concurrent opener cannot see it half initialized. */
   list_push_front (&open_inodes, &inode->elem);
   inode->sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
-  block_read (fs_device, inode->sector, &inode->data);
+  inode->metadata = false;
+  rwlock_init (&inode->rwlock);
+  lock_init (&inode->dir_lock);
+  journal_read (inode->sector, &inode->data);
+  lock_release (&open_inodes_lock);
   return inode;
 }
 
@@ -127,7 +388,11 @@ struct inode *
 inode_reopen (struct inode *inode)
 {
   if (inode != NULL)
-    inode->open_cnt++;
+    {
+      lock_acquire (&open_inodes_lock);
+      inode->open_cnt++;
+      lock_release (&open_inodes_lock);
+    }
   return inode;
 }
 
@@ -149,21 +414,30 @@ inode_close (struct inode *inode)
     return;
 
   /* Release resources if this was the last opener. */
+  lock_acquire (&open_inodes_lock);
   if (--inode->open_cnt == 0)
     {
       /* Remove from inode list and release lock. */
+      if (inode->rwlock.peak_reader_cnt > peak_reader_cnt)
+        peak_reader_cnt = inode->rwlock.peak_reader_cnt;
       list_remove (&inode->elem);
+      lock_release (&open_inodes_lock);
  
-      /* Deallocate blocks if removed. */
+      /* Deallocate blocks if removed, as a journal operation of
+         its own unless the caller has one open. */
       if (inode->removed) 
         {
+          journal_begin ();
           free_map_release (inode->sector, 1);
-          free_map_release (inode->data.start,
-                            bytes_to_sectors (inode->data.length)); 
+          release_sectors (inode);
+          free_map_flush ();
+          journal_end ();
         }
 
       free (inode); 
     }
+  else
+    lock_release (&open_inodes_lock);
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -177,18 +451,37 @@ inode_remove (struct inode *inode)
 
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
    Returns the number of bytes actually read, which may be less
-   than SIZE if an error occurs or end of file is reached. */
+   than SIZE if an error occurs or end of file is reached.
+   Runs in parallel with other reads of INODE, but not with
+   writes. */
 off_t
 inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) 
 {
   uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
   uint8_t *bounce = NULL;
+  struct index_cache *cache = NULL;
+
+  rwlock_acquire_read (&inode->rwlock);
+  if (inode->data.flags & INODE_INLINE)
+    {
+      /* Tiny files are read straight out of the inode. */
+      if (offset < inode->data.length)
+        {
+          bytes_read = inode->data.length - offset;
+          if (size < bytes_read)
+            bytes_read = size;
+          memcpy (buffer, inode->data.inline_data + offset, bytes_read);
+        }
+      rwlock_release_read (&inode->rwlock);
+      return bytes_read;
+    }
 
   while (size > 0) 
     {
       /* Disk sector to read, starting byte offset within sector. */
-      block_sector_t sector_idx = byte_to_sector (inode, offset);
+      size_t idx;
+      block_sector_t sector_idx;
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
       /* Bytes left in inode, bytes left in sector, lesser of the two. */
@@ -201,10 +494,28 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       if (chunk_size <= 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
+      idx = offset / BLOCK_SECTOR_SIZE;
+      sector_idx = index_to_sector (inode, idx, false, &cache);
+      if (sector_idx == 0 || (sector_idx & INODE_UNWRITTEN))
         {
-          /* Read full sector directly into caller's buffer. */
-          block_read (fs_device, sector_idx, buffer + bytes_read);
+          /* Holes and unwritten sectors read as zeros without
+             touching the disk. */
+          memset (buffer + bytes_read, 0, chunk_size);
+        }
+      else if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
+        {
+          /* Read full sectors directly into caller's buffer,
+             merging a run of sectors that are also consecutive
+             on disk into a single request. */
+          size_t cnt = 1;
+          while (size - (off_t) cnt * BLOCK_SECTOR_SIZE >= BLOCK_SECTOR_SIZE
+                 && inode_left - (off_t) cnt * BLOCK_SECTOR_SIZE
+                    >= BLOCK_SECTOR_SIZE
+                 && index_to_sector (inode, idx + cnt, false, &cache)
+                    == sector_idx + cnt)
+            cnt++;
+          journal_read_multiple (sector_idx, cnt, buffer + bytes_read);
+          chunk_size = cnt * BLOCK_SECTOR_SIZE;
         }
       else 
         {
@@ -216,7 +527,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
               if (bounce == NULL)
                 break;
             }
-          block_read (fs_device, sector_idx, bounce);
+          journal_read (sector_idx, bounce);
           memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
         }
       
@@ -225,16 +536,89 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       offset += chunk_size;
       bytes_read += chunk_size;
     }
+  rwlock_release_read (&inode->rwlock);
+  free (cache);
   free (bounce);
 
   return bytes_read;
 }
 
+/* Starts a journal operation covering the sectors that a write
+   to INODE allocates and the growth of INODE, unless one is
+   already open in *IN_OP.  Metadata inodes are written only
+   within file system operations that already hold one. */
+static void
+begin_extend (struct inode *inode, bool *in_op)
+{
+  if (!*in_op && !inode->metadata)
+    {
+      journal_begin ();
+      *in_op = true;
+    }
+}
+
+/* Ends the journal operation opened by begin_extend(), if any,
+   after writing back the free map sectors it changed. */
+static void
+end_extend (bool *in_op)
+{
+  if (*in_op)
+    {
+      free_map_flush ();
+      journal_end ();
+      *in_op = false;
+    }
+}
+
+/* Moves the data of inline INODE out to a newly allocated data
+   sector, so that it can grow past INODE_INLINE_MAX bytes.
+   Opens a journal operation in *IN_OP as begin_extend() does.
+   Returns true if successful, false if memory or disk space is
+   short, in which case INODE is left inline. */
+static bool
+migrate_inline (struct inode *inode, bool *in_op)
+{
+  struct inode_disk *d = &inode->data;
+  uint8_t *data;
+  bool success = true;
+
+  ASSERT (d->flags & INODE_INLINE);
+
+  data = calloc (1, BLOCK_SECTOR_SIZE);
+  if (data == NULL)
+    return false;
+  memcpy (data, d->inline_data, d->length);
+
+  begin_extend (inode, in_op);
+  memset (d->inline_data, 0, sizeof d->inline_data);
+  d->flags &= ~INODE_INLINE;
+  if (d->length > 0)
+    {
+      struct index_cache *cache = NULL;
+      block_sector_t sector = index_to_sector (inode, 0, true, &cache);
+      free (cache);
+      if (sector != 0)
+        write_sector (inode, sector, data);
+      else
+        {
+          memcpy (d->inline_data, data, d->length);
+          d->flags |= INODE_INLINE;
+          success = false;
+        }
+    }
+  if (success)
+    journal_write (inode->sector, d);
+
+  free (data);
+  return success;
+}
+
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
    Returns the number of bytes actually written, which may be
-   less than SIZE if end of file is reached or an error occurs.
-   (Normally a write at end of file would extend the inode, but
-   growth is not yet implemented.) */
+   less than SIZE if the disk is full, the maximum file size is
+   reached, or an error occurs.  A write past end of file extends
+   the inode; any gap before OFFSET is left as a hole.  Excludes
+   all other reads and writes of INODE. */
 off_t
 inode_write_at (struct inode *inode, const void *buffer_, off_t size,
                 off_t offset) 
@@ -242,30 +626,86 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
   const uint8_t *buffer = buffer_;
   off_t bytes_written = 0;
   uint8_t *bounce = NULL;
+  struct index_cache *cache = NULL;
+  bool in_op = false;
+  int allocated = 0;
 
+  rwlock_acquire_write (&inode->rwlock);
   if (inode->deny_write_cnt)
-    return 0;
+    {
+      rwlock_release_write (&inode->rwlock);
+      return 0;
+    }
+
+  if ((inode->data.flags & INODE_INLINE) && size > 0)
+    {
+      if (offset > (off_t) INODE_INLINE_MAX - size)
+        {
+          /* Too big to stay inline. */
+          if (!migrate_inline (inode, &in_op))
+            {
+              end_extend (&in_op);
+              rwlock_release_write (&inode->rwlock);
+              return 0;
+            }
+        }
+      else
+        {
+          /* Update the data inside the inode, which a single
+             sector write carries to disk atomically. */
+          begin_extend (inode, &in_op);
+          memcpy (inode->data.inline_data + offset, buffer, size);
+          if (offset + size > inode->data.length)
+            inode->data.length = offset + size;
+          journal_write (inode->sector, &inode->data);
+          end_extend (&in_op);
+          rwlock_release_write (&inode->rwlock);
+          return size;
+        }
+    }
 
   while (size > 0) 
     {
       /* Sector to write, starting byte offset within sector. */
-      block_sector_t sector_idx = byte_to_sector (inode, offset);
+      size_t idx = offset / BLOCK_SECTOR_SIZE;
+      block_sector_t sector_idx;
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
+      bool hole = false;
 
-      /* Bytes left in inode, bytes left in sector, lesser of the two. */
-      off_t inode_left = inode_length (inode) - offset;
+      /* Bytes left in sector; number of bytes to write into it. */
       int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
-      int min_left = inode_left < sector_left ? inode_left : sector_left;
-
-      /* Number of bytes to actually write into this sector. */
-      int chunk_size = size < min_left ? size : min_left;
-      if (chunk_size <= 0)
+      int chunk_size = size < sector_left ? size : sector_left;
+      if (offset >= INODE_MAX_LENGTH)
         break;
 
+      sector_idx = index_to_sector (inode, idx, false, &cache);
+      if (sector_idx == 0)
+        {
+          /* First write to this sector: allocate it. */
+          begin_extend (inode, &in_op);
+          sector_idx = index_to_sector (inode, idx, true, &cache);
+          if (sector_idx == 0)
+            break;
+          hole = true;
+          allocated++;
+        }
+      else if (sector_idx & INODE_UNWRITTEN)
+        {
+          /* First write to a preallocated sector: mark it
+             written.  Its old contents are garbage, so it is
+             filled in like a hole. */
+          begin_extend (inode, &in_op);
+          sector_idx &= ~INODE_UNWRITTEN;
+          if (!set_sector (inode, idx, sector_idx, &cache))
+            break;
+          hole = true;
+          allocated++;
+        }
+
       if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
         {
           /* Write full sector directly to disk. */
-          block_write (fs_device, sector_idx, buffer + bytes_written);
+          write_sector (inode, sector_idx, buffer + bytes_written);
         }
       else 
         {
@@ -279,32 +719,144 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 
           /* If the sector contains data before or after the chunk
              we're writing, then we need to read in the sector
-             first.  Otherwise we start with a sector of all zeros. */
-          if (sector_ofs > 0 || chunk_size < sector_left) 
-            block_read (fs_device, sector_idx, bounce);
+             first.  Otherwise, or if the sector was a hole, we
+             start with a sector of all zeros. */
+          if (!hole && (sector_ofs > 0 || chunk_size < sector_left))
+            journal_read (sector_idx, bounce);
           else
             memset (bounce, 0, BLOCK_SECTOR_SIZE);
           memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-          block_write (fs_device, sector_idx, bounce);
+          write_sector (inode, sector_idx, bounce);
         }
 
       /* Advance. */
       size -= chunk_size;
       offset += chunk_size;
       bytes_written += chunk_size;
+
+      /* Extend the file. */
+      if (offset > inode->data.length)
+        {
+          begin_extend (inode, &in_op);
+          inode->data.length = offset;
+          journal_write (inode->sector, &inode->data);
+        }
+
+      /* Keep each journal operation small. */
+      if (allocated >= WRITE_BATCH_SECTORS)
+        {
+          end_extend (&in_op);
+          allocated = 0;
+        }
     }
+  end_extend (&in_op);
+  rwlock_release_write (&inode->rwlock);
+  free (cache);
   free (bounce);
 
   return bytes_written;
 }
 
+/* Reserves disk sectors for bytes OFFSET through OFFSET +
+   LENGTH - 1 of INODE without writing them, and extends INODE to
+   OFFSET + LENGTH bytes if it is shorter.  Each run of holes is
+   filled with sectors that are consecutive on disk wherever free
+   space allows.  The new sectors are marked unwritten, so they
+   keep reading as zeros until they are first written.  Parts of
+   the range that already have sectors are left alone.
+   Returns true if successful, false if writes to INODE are
+   denied, the range is too large, or the disk is full, in which
+   case some of the range may already have been reserved. */
+bool
+inode_fallocate (struct inode *inode, off_t offset, off_t length)
+{
+  struct inode_disk *d = &inode->data;
+  block_sector_t hint = inode->sector;
+  bool in_op = false;
+  bool success = true;
+  struct index_cache *cache = NULL;
+  off_t end;
+  size_t idx, last;
+
+  if (offset < 0 || length <= 0 || length > INODE_MAX_LENGTH - offset)
+    return length == 0 && offset >= 0;
+  end = offset + length;
+
+  rwlock_acquire_write (&inode->rwlock);
+  if (inode->deny_write_cnt)
+    success = false;
+  else if ((d->flags & INODE_INLINE) && (size_t) end > INODE_INLINE_MAX)
+    success = migrate_inline (inode, &in_op);
+
+  if (success && !(d->flags & INODE_INLINE))
+    {
+      idx = offset / BLOCK_SECTOR_SIZE;
+      last = (end - 1) / BLOCK_SECTOR_SIZE;
+      while (success && idx <= last)
+        {
+          block_sector_t start;
+          size_t run, i;
+
+          if (index_to_sector (inode, idx, false, &cache) != 0)
+            {
+              idx++;
+              continue;
+            }
+
+          /* Measure the run of holes starting at IDX, up to a
+             journal operation's worth. */
+          run = 1;
+          while (idx + run <= last && run < WRITE_BATCH_SECTORS
+                 && index_to_sector (inode, idx + run, false, &cache) == 0)
+            run++;
+
+          /* Take the longest consecutive stretch available. */
+          begin_extend (inode, &in_op);
+          while (!free_map_allocate (run, hint, &start))
+            if (run > 1)
+              run /= 2;
+            else
+              {
+                success = false;
+                break;
+              }
+
+          for (i = 0; success && i < run; i++)
+            if (!set_sector (inode, idx + i, (start + i) | INODE_UNWRITTEN,
+                             &cache))
+              {
+                free_map_release (start + i, run - i);
+                success = false;
+              }
+          end_extend (&in_op);
+
+          hint = start + run;
+          idx += run;
+        }
+    }
+
+  if (success && end > d->length)
+    {
+      begin_extend (inode, &in_op);
+      d->length = end;
+      journal_write (inode->sector, d);
+    }
+  end_extend (&in_op);
+  rwlock_release_write (&inode->rwlock);
+  free (cache);
+
+  return success;
+}
+
 /* Disables writes to INODE.
    May be called at most once per inode opener. */
 void
 inode_deny_write (struct inode *inode) 
 {
+  rwlock_acquire_write (&inode->rwlock);
   inode->deny_write_cnt++;
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
+  rwlock_release_write (&inode->rwlock);
 }
 
 /* Re-enables writes to INODE.
@@ -313,9 +865,11 @@ inode_deny_write (struct inode *inode)
 void
 inode_allow_write (struct inode *inode) 
 {
+  rwlock_acquire_write (&inode->rwlock);
   ASSERT (inode->deny_write_cnt > 0);
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
   inode->deny_write_cnt--;
+  rwlock_release_write (&inode->rwlock);
 }
 
 /* Returns the length, in bytes, of INODE's data. */
@@ -324,3 +878,11 @@ inode_length (const struct inode *inode)
 {
   return inode->data.length;
 }
+
+/* Marks INODE as holding file system metadata, such as a
+   directory or the free map, whose data writes are journaled. */
+void
+inode_set_metadata (struct inode *inode)
+{
+  inode->metadata = true;
+}
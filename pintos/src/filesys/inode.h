@@ -5,19 +5,64 @@
 #include "filesys/off_t.h"
 #include "devices/block.h"
 #include "lib/kernel/list.h"
+#include "threads/synch.h"
+
+/* Number of data sectors named directly by an inode. */
+#define INODE_DIRECT_CNT 123
+
+/* Largest file, in bytes, whose data fits inside its inode. */
+#define INODE_INLINE_MAX ((INODE_DIRECT_CNT + 2) * sizeof (block_sector_t))
+
+/* Inode flags. */
+#define INODE_INLINE 0x1                /* Data is in INLINE_DATA. */
+
+/* Set in a data sector pointer whose sector is reserved but has
+   never been written. */
+#define INODE_UNWRITTEN 0x80000000
 
 /* On-disk inode.
-   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+   Must be exactly BLOCK_SECTOR_SIZE bytes long.
+
+   A file of at most INODE_INLINE_MAX bytes keeps its data in
+   INLINE_DATA, inside the inode sector itself, and has the
+   INODE_INLINE flag set.  It moves out to data sectors the first
+   time it grows past INODE_INLINE_MAX bytes.  Bytes of
+   INLINE_DATA past the end of the file are always zero.
+
+   Otherwise, data sectors are found through DIRECT, then through
+   the sector of pointers named by INDIRECT, then through the two
+   levels of pointer sectors under DOUBLY_INDIRECT.  A pointer of
+   0 means that the sector, or everything under it, has never
+   been written: it is a hole, which reads as zeros.  (Sector 0
+   always holds the free map inode, so it is never file data.)
+   A data sector pointer with INODE_UNWRITTEN set names a sector
+   reserved by inode_fallocate() that also reads as zeros; the
+   flag is cleared by the first write to the sector. */
 struct inode_disk
   {
-    block_sector_t start;               /* First data sector. */
+    union
+      {
+        struct
+          {
+            block_sector_t direct[INODE_DIRECT_CNT]; /* Direct data sectors. */
+            block_sector_t indirect;    /* Sector of data pointers. */
+            block_sector_t doubly_indirect; /* Sector of indirect pointers. */
+          };
+        uint8_t inline_data[INODE_INLINE_MAX]; /* Data of a tiny file. */
+      };
     off_t length;                       /* File size in bytes. */
+    uint32_t flags;                     /* INODE_* flags. */
     unsigned magic;                     /* Magic number. */
-    uint32_t unused[125];               /* Not used. */
   };
 
 
-/* In-memory inode. */
+/* In-memory inode.
+
+   RWLOCK is held for reading by inode_read_at() and for writing
+   by inode_write_at(), so that any number of readers proceed in
+   parallel while writes, including growth past end of file, are
+   exclusive.  It protects DATA and DENY_WRITE_CNT.  DIR_LOCK
+   serializes changes to the entries of a directory. */
 struct inode 
   {
     struct list_elem elem;              /* Element in inode list. */
@@ -25,6 +70,9 @@ struct inode
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    bool metadata;                      /* Journal data writes? */
+    struct rwlock rwlock;               /* Readers/writer lock on data. */
+    struct lock dir_lock;               /* Directory entry lock. */
     struct inode_disk data;             /* Inode content. */
   };
 
@@ -32,6 +80,7 @@ struct inode
 struct bitmap;
 
 void inode_init (void);
+void inode_print_stats (void);
 bool inode_create (block_sector_t, off_t);
 struct inode *inode_open (block_sector_t);
 struct inode *inode_reopen (struct inode *);
@@ -40,8 +89,10 @@ void inode_close (struct inode *);
 void inode_remove (struct inode *);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
 off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
+bool inode_fallocate (struct inode *, off_t offset, off_t length);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
 off_t inode_length (const struct inode *);
+void inode_set_metadata (struct inode *);
 
 #endif /* filesys/inode.h */
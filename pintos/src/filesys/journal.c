@@ -0,0 +1,422 @@
+#include "filesys/journal.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/filesys.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Metadata write-ahead journal.
+
+   Writes to file system metadata (inodes, directory contents and
+   the free map) made between journal_begin() and journal_end()
+   are not written in place.  Instead, journal_write() keeps the
+   newest copy of each sector in memory, and reads through
+   journal_read() see those copies.  Committing a transaction
+   writes the copies to the journal area, then writes the journal
+   header naming their home sectors, which is the commit point,
+   then copies them home and clears the header.
+
+   A crash before the header write loses the transaction as a
+   whole; a crash after it is repaired by journal_init(), which
+   replays the logged sectors.  Either way the metadata on disk
+   is consistent, and recovery reads only the journal area.
+
+   File data is not journaled.  It is written in place as soon as
+   it is written, before the transaction that makes it reachable
+   commits.
+
+   Several operations are grouped into each transaction to
+   amortize the cost of a commit: a transaction commits once
+   JOURNAL_GROUP_OPS operations have ended, when it has too
+   little room left for another operation, or at journal_sync().
+
+   Every operation reserves room in the transaction for its
+   writes when it begins, so every metadata write must belong to
+   one.  A thread that begins an operation while it already has
+   one open joins the open one, and a metadata write by a thread
+   with none open becomes an operation of its own. */
+
+/* Identifies a journal header. */
+#define JOURNAL_MAGIC 0x4a524e4c
+
+/* Maximum number of sectors logged in a transaction. */
+#define JOURNAL_DATA_MAX (JOURNAL_SECTORS - 1)
+
+/* Room reserved in the transaction for each operation. */
+#define JOURNAL_OP_SECTORS 8
+
+/* Operations grouped into a transaction before it commits. */
+#define JOURNAL_GROUP_OPS 8
+
+/* On-disk journal header, stored in JOURNAL_SECTOR.
+   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+struct journal_header
+  {
+    unsigned magic;                     /* Magic number. */
+    uint32_t seq;                       /* Transaction sequence number. */
+    uint32_t sector_cnt;                /* Sectors to replay, 0 if none. */
+    block_sector_t sectors[JOURNAL_DATA_MAX]; /* Home of each logged sector. */
+    uint32_t unused[128 - 3 - JOURNAL_DATA_MAX]; /* Not used. */
+  };
+
+/* A sector changed by the running transaction. */
+struct pending_sector
+  {
+    block_sector_t sector;              /* Home sector. */
+    uint8_t *data;                      /* Newest contents. */
+  };
+
+/* The running transaction. */
+static struct pending_sector pending[JOURNAL_DATA_MAX];
+static size_t pending_cnt;              /* Number of sectors in PENDING. */
+static int active_cnt;                  /* Operations in progress. */
+static int op_cnt;                      /* Operations ended. */
+
+/* Protects the running transaction.  journal_idle is signaled
+   whenever active_cnt drops to 0. */
+static struct lock journal_lock;
+static struct condition journal_idle;
+
+/* Buffer for the journal header. */
+static struct journal_header header;
+
+/* True after a simulated crash: all further writes are dropped,
+   so that the disk looks as it did at the moment of the crash. */
+static bool crashed;
+
+/* Operation to crash after, counting from journal_arm_crash(),
+   if positive. */
+int journal_crash_after;
+
+/* Crash at the commit that covers this operation, counting all
+   operations ever ended, or never if 0. */
+static unsigned long long crash_op;
+
+/* Statistics. */
+static unsigned long long commit_cnt;   /* Transactions committed. */
+static unsigned long long logged_cnt;   /* Sectors written to the log. */
+static unsigned long long group_cnt;    /* Operations committed. */
+
+static void commit (void);
+static struct pending_sector *find_pending (block_sector_t);
+static void replay (void);
+
+/* Initializes the journal.  If FORMAT is true, starts with an
+   empty journal, otherwise replays any committed transaction
+   that was not yet copied home. */
+void
+journal_init (bool format)
+{
+  uint8_t *data;
+  size_t i;
+
+  ASSERT (sizeof header == BLOCK_SECTOR_SIZE);
+
+  lock_init (&journal_lock);
+  cond_init (&journal_idle);
+
+  data = malloc (JOURNAL_DATA_MAX * BLOCK_SECTOR_SIZE);
+  if (data == NULL)
+    PANIC ("journal buffer allocation failed");
+  for (i = 0; i < JOURNAL_DATA_MAX; i++)
+    pending[i].data = data + i * BLOCK_SECTOR_SIZE;
+
+  if (format)
+    {
+      memset (&header, 0, sizeof header);
+      header.magic = JOURNAL_MAGIC;
+      block_write (fs_device, JOURNAL_SECTOR, &header);
+    }
+  else
+    {
+      /* The recovery boot shares the crashing boot's command
+         line, so only inject crashes into a fresh file system. */
+      journal_crash_after = 0;
+      replay ();
+    }
+}
+
+/* Starts a file system operation whose metadata writes must
+   reach disk atomically.  Must be paired with journal_end().
+   If the running thread already has an operation open, the new
+   one becomes part of it, since waiting for room could mean
+   waiting for the open one to end. */
+void
+journal_begin (void)
+{
+  if (thread_current ()->journal_depth++ > 0)
+    return;
+
+  lock_acquire (&journal_lock);
+  while (pending_cnt + (active_cnt + 1) * JOURNAL_OP_SECTORS
+         > JOURNAL_DATA_MAX)
+    {
+      if (active_cnt == 0)
+        commit ();
+      else
+        cond_wait (&journal_idle, &journal_lock);
+    }
+  active_cnt++;
+  lock_release (&journal_lock);
+}
+
+/* Ends an operation started with journal_begin().  Commits the
+   running transaction if enough operations have been grouped
+   into it. */
+void
+journal_end (void)
+{
+  struct thread *t = thread_current ();
+
+  ASSERT (t->journal_depth > 0);
+  if (--t->journal_depth > 0)
+    return;
+
+  lock_acquire (&journal_lock);
+  ASSERT (active_cnt > 0);
+  active_cnt--;
+  op_cnt++;
+  if (active_cnt == 0)
+    {
+      if (op_cnt >= JOURNAL_GROUP_OPS
+          || pending_cnt + JOURNAL_OP_SECTORS > JOURNAL_DATA_MAX)
+        commit ();
+      cond_broadcast (&journal_idle, &journal_lock);
+    }
+  lock_release (&journal_lock);
+}
+
+/* Waits for operations in progress to end, then commits the
+   running transaction. */
+void
+journal_sync (void)
+{
+  if (crashed)
+    return;
+
+  lock_acquire (&journal_lock);
+  while (active_cnt > 0)
+    cond_wait (&journal_idle, &journal_lock);
+  commit ();
+  lock_release (&journal_lock);
+}
+
+/* Starts counting operations toward the crash requested with
+   journal_crash_after, if any.  Counting from a point of the
+   caller's choosing, instead of from boot, keeps the crash at the
+   same place in a test whatever the file system did beforehand,
+   such as extracting the test's files, and however operations
+   are grouped into transactions. */
+void
+journal_arm_crash (void)
+{
+  if (journal_crash_after <= 0)
+    return;
+
+  lock_acquire (&journal_lock);
+  crash_op = group_cnt + op_cnt + journal_crash_after;
+  lock_release (&journal_lock);
+}
+
+/* Reads SECTOR of the file system device into BUFFER, which must
+   have room for BLOCK_SECTOR_SIZE bytes, taking changes not yet
+   written home into account. */
+void
+journal_read (block_sector_t sector, void *buffer)
+{
+  struct pending_sector *p;
+
+  lock_acquire (&journal_lock);
+  p = find_pending (sector);
+  if (p != NULL)
+    memcpy (buffer, p->data, BLOCK_SECTOR_SIZE);
+  lock_release (&journal_lock);
+
+  if (p == NULL)
+    block_read (fs_device, sector, buffer);
+}
+
+/* Reads the CNT sectors starting at SECTOR into BUFFER, which
+   must have room for CNT * BLOCK_SECTOR_SIZE bytes, as
+   journal_read() does for one.  Issues a single device request
+   unless the running transaction holds one of the sectors. */
+void
+journal_read_multiple (block_sector_t sector, block_sector_t cnt,
+                       void *buffer)
+{
+  uint8_t *p = buffer;
+  bool pending_any = false;
+  block_sector_t i;
+
+  lock_acquire (&journal_lock);
+  for (i = 0; i < pending_cnt; i++)
+    if (pending[i].sector >= sector && pending[i].sector - sector < cnt)
+      pending_any = true;
+  lock_release (&journal_lock);
+
+  if (!pending_any)
+    block_read_multiple (fs_device, sector, cnt, buffer);
+  else
+    for (i = 0; i < cnt; i++)
+      journal_read (sector + i, p + i * BLOCK_SECTOR_SIZE);
+}
+
+/* Writes metadata BUFFER, which must contain BLOCK_SECTOR_SIZE
+   bytes, to SECTOR of the file system device, as part of the
+   running transaction.  If the running thread has no operation
+   open, the write is made an operation of its own, so that it
+   has room reserved like any other. */
+void
+journal_write (block_sector_t sector, const void *buffer)
+{
+  struct pending_sector *p;
+
+  if (thread_current ()->journal_depth == 0)
+    {
+      journal_begin ();
+      journal_write (sector, buffer);
+      journal_end ();
+      return;
+    }
+
+  lock_acquire (&journal_lock);
+  if (!crashed)
+    {
+      p = find_pending (sector);
+      if (p == NULL)
+        {
+          /* Each operation stays within the room it reserved,
+             so the reservations cover every pending sector. */
+          ASSERT (pending_cnt < JOURNAL_DATA_MAX);
+          p = &pending[pending_cnt++];
+          p->sector = sector;
+        }
+      memcpy (p->data, buffer, BLOCK_SECTOR_SIZE);
+    }
+  lock_release (&journal_lock);
+}
+
+/* Writes file data BUFFER, which must contain BLOCK_SECTOR_SIZE
+   bytes, in place to SECTOR of the file system device.  If the
+   running transaction holds an older copy of SECTOR, e.g.
+   because it was freed metadata, the copy is updated instead so
+   that committing does not overwrite the data. */
+void
+journal_write_data (block_sector_t sector, const void *buffer)
+{
+  struct pending_sector *p;
+
+  lock_acquire (&journal_lock);
+  if (crashed)
+    {
+      lock_release (&journal_lock);
+      return;
+    }
+  p = find_pending (sector);
+  if (p != NULL)
+    memcpy (p->data, buffer, BLOCK_SECTOR_SIZE);
+  lock_release (&journal_lock);
+
+  if (p == NULL)
+    block_write (fs_device, sector, buffer);
+}
+
+/* Prints journal statistics. */
+void
+journal_print_stats (void)
+{
+  printf ("Journal: %llu commits, %llu operations, %llu sectors logged\n",
+          commit_cnt, group_cnt, logged_cnt);
+}
+
+/* Commits the running transaction and copies it home.
+   The caller must hold journal_lock, and no operation may be in
+   progress. */
+static void
+commit (void)
+{
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&journal_lock));
+  ASSERT (active_cnt == 0);
+
+  if (crashed || pending_cnt == 0)
+    {
+      pending_cnt = 0;
+      op_cnt = 0;
+      return;
+    }
+
+  /* Log the new contents, then write the commit record.  The
+     copies are contiguous in memory, as are their log slots. */
+  block_write_multiple (fs_device, JOURNAL_SECTOR + 1, pending_cnt,
+                        pending[0].data);
+  for (i = 0; i < pending_cnt; i++)
+    header.sectors[i] = pending[i].sector;
+  header.magic = JOURNAL_MAGIC;
+  header.seq++;
+  header.sector_cnt = pending_cnt;
+  block_write (fs_device, JOURNAL_SECTOR, &header);
+  commit_cnt++;
+  logged_cnt += pending_cnt;
+  group_cnt += op_cnt;
+
+  if (crash_op != 0 && group_cnt >= crash_op)
+    {
+      crashed = true;
+      lock_release (&journal_lock);
+      PANIC ("journal: simulated crash after commit %llu", commit_cnt);
+    }
+
+  /* Copy home, then retire the transaction. */
+  for (i = 0; i < pending_cnt; i++)
+    block_write (fs_device, pending[i].sector, pending[i].data);
+  header.sector_cnt = 0;
+  block_write (fs_device, JOURNAL_SECTOR, &header);
+
+  pending_cnt = 0;
+  op_cnt = 0;
+}
+
+/* Returns the running transaction's copy of SECTOR, or a null
+   pointer if it has none.  The caller must hold journal_lock. */
+static struct pending_sector *
+find_pending (block_sector_t sector)
+{
+  size_t i;
+
+  for (i = 0; i < pending_cnt; i++)
+    if (pending[i].sector == sector)
+      return &pending[i];
+  return NULL;
+}
+
+/* Copies home the sectors of a transaction that committed but
+   may not have been copied home before the system went down. */
+static void
+replay (void)
+{
+  uint8_t *buffer = pending[0].data;
+  size_t i;
+
+  /* PENDING's buffers are contiguous, so BUFFER has room for a
+     whole transaction. */
+  block_read (fs_device, JOURNAL_SECTOR, &header);
+  if (header.magic != JOURNAL_MAGIC)
+    PANIC ("file system has no journal (reformat with -f)");
+  if (header.sector_cnt == 0)
+    return;
+  if (header.sector_cnt > JOURNAL_DATA_MAX)
+    PANIC ("corrupt journal header");
+
+  printf ("journal: replaying transaction %"PRIu32" (%"PRIu32" sectors)\n",
+          header.seq, header.sector_cnt);
+  block_read_multiple (fs_device, JOURNAL_SECTOR + 1, header.sector_cnt,
+                       buffer);
+  for (i = 0; i < header.sector_cnt; i++)
+    block_write (fs_device, header.sectors[i], buffer + i * BLOCK_SECTOR_SIZE);
+  header.sector_cnt = 0;
+  block_write (fs_device, JOURNAL_SECTOR, &header);
+}
@@ -0,0 +1,32 @@
+#ifndef FILESYS_JOURNAL_H
+#define FILESYS_JOURNAL_H
+
+#include <stdbool.h>
+#include "devices/block.h"
+
+/* Number of sectors reserved for the journal, starting at
+   JOURNAL_SECTOR: one header sector plus the logged sectors. */
+#define JOURNAL_SECTORS 64
+
+/* If positive, journal_arm_crash() arranges to crash right after
+   writing the commit record of the transaction that covers the
+   given file system operation, counting from the call, for
+   testing recovery.  Only takes effect when the file system is
+   formatted during boot.
+   Controlled by kernel command-line option "-jcrash=N". */
+extern int journal_crash_after;
+
+void journal_init (bool format);
+void journal_begin (void);
+void journal_end (void);
+void journal_sync (void);
+void journal_arm_crash (void);
+
+void journal_read (block_sector_t, void *);
+void journal_read_multiple (block_sector_t, block_sector_t cnt, void *);
+void journal_write (block_sector_t, const void *);
+void journal_write_data (block_sector_t, const void *);
+
+void journal_print_stats (void);
+
+#endif /* filesys/journal.h */
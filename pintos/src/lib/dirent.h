@@ -0,0 +1,21 @@
+#ifndef __LIB_DIRENT_H
+#define __LIB_DIRENT_H
+
+#include <stdint.h>
+
+/* Longest file name stored in a struct dirent. */
+#define DIRENT_NAME_MAX 14
+
+/* Types of file named by a struct dirent. */
+#define DT_REG 1                /* Regular file. */
+#define DT_DIR 2                /* Directory. */
+
+/* A directory entry, as returned by getdents(). */
+struct dirent
+  {
+    uint32_t d_ino;                     /* Inode number. */
+    uint8_t d_type;                     /* DT_REG or DT_DIR. */
+    char d_name[DIRENT_NAME_MAX + 1];   /* Null terminated file name. */
+  };
+
+#endif /* lib/dirent.h */
@@ -299,14 +299,42 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value)
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
 
-  if (cnt <= b->bit_cnt) 
-    {
-      size_t last = b->bit_cnt - cnt;
-      size_t i;
-      for (i = start; i <= last; i++)
-        if (!bitmap_contains (b, i, cnt, !value))
-          return i; 
-    }
+  return bitmap_scan_range (b, start, b->bit_cnt, cnt, value);
+}
+
+/* Finds and returns the starting index of the first group of CNT
+   consecutive bits in B that are all set to VALUE and lie between
+   START and END, exclusive.
+   If there is no such group, returns BITMAP_ERROR.
+   Takes time linear in END - START, regardless of CNT: each bit
+   is examined once, and whole elements whose bits are all
+   !VALUE are skipped at once. */
+size_t
+bitmap_scan_range (const struct bitmap *b, size_t start, size_t end,
+                   size_t cnt, bool value)
+{
+  elem_type skip = value ? 0 : (elem_type) -1;
+  size_t run = 0;
+  size_t i;
+
+  ASSERT (b != NULL);
+  ASSERT (start <= end);
+  ASSERT (end <= b->bit_cnt);
+
+  if (cnt == 0)
+    return start;
+
+  for (i = start; i < end; )
+    if (run == 0 && i % ELEM_BITS == 0 && end - i >= ELEM_BITS
+        && b->bits[elem_idx (i)] == skip)
+      i += ELEM_BITS;
+    else if (bitmap_test (b, i++) == value)
+      {
+        if (++run == cnt)
+          return i - cnt;
+      }
+    else
+      run = 0;
   return BITMAP_ERROR;
 }
 
@@ -359,6 +387,24 @@ bitmap_write (const struct bitmap *b, struct file *file)
   off_t size = byte_cnt (b->bit_cnt);
   return file_write_at (file, b->bits, size, 0) == size;
 }
+
+/* Writes the SIZE bytes of B that start at byte offset OFS of
+   its file representation (as written by bitmap_write()) to the
+   same offset in FILE.  The range is clipped to the end of B.
+   Return true if successful, false otherwise. */
+bool
+bitmap_write_range (const struct bitmap *b, struct file *file,
+                    size_t ofs, size_t size)
+{
+  size_t file_size = byte_cnt (b->bit_cnt);
+
+  if (ofs >= file_size)
+    return true;
+  if (size > file_size - ofs)
+    size = file_size - ofs;
+  return (file_write_at (file, (uint8_t *) b->bits + ofs, size, ofs)
+          == (off_t) size);
+}
 #endif /* FILESYS */
 
 /* Debugging. */
@@ -0,0 +1,229 @@
+#include "heap.h"
+#include "../debug.h"
+
+static struct heap_elem *elem_at (const struct heap *, size_t pos);
+static void replace_child (struct heap *, struct heap_elem *parent,
+                           struct heap_elem *old, struct heap_elem *new);
+static void swap_with_child (struct heap *, struct heap_elem *parent,
+                             struct heap_elem *child);
+static void sift_up (struct heap *, struct heap_elem *);
+static void sift_down (struct heap *, struct heap_elem *);
+
+/* Initializes heap H as empty, ordered by LESS given auxiliary
+   data AUX. */
+void
+heap_init (struct heap *h, heap_less_func *less, void *aux) 
+{
+  ASSERT (h != NULL);
+  ASSERT (less != NULL);
+
+  h->root = NULL;
+  h->size = 0;
+  h->less = less;
+  h->aux = aux;
+}
+
+/* Returns the number of elements in H. */
+size_t
+heap_size (const struct heap *h) 
+{
+  return h->size;
+}
+
+/* Returns true if H is empty, false otherwise. */
+bool
+heap_empty (const struct heap *h) 
+{
+  return h->root == NULL;
+}
+
+/* Inserts E into H. */
+void
+heap_insert (struct heap *h, struct heap_elem *e) 
+{
+  ASSERT (h != NULL);
+  ASSERT (e != NULL);
+
+  e->left = e->right = NULL;
+  h->size++;
+  if (h->size == 1)
+    {
+      e->parent = NULL;
+      h->root = e;
+      return;
+    }
+
+  /* The new last position's parent is at half its index. */
+  e->parent = elem_at (h, h->size / 2);
+  if (h->size % 2 == 0)
+    e->parent->left = e;
+  else
+    e->parent->right = e;
+  sift_up (h, e);
+}
+
+/* Returns the maximum element in H, which must not be empty. */
+struct heap_elem *
+heap_max (const struct heap *h) 
+{
+  ASSERT (!heap_empty (h));
+  return h->root;
+}
+
+/* Removes the maximum element from H, which must not be empty,
+   and returns it. */
+struct heap_elem *
+heap_pop_max (struct heap *h) 
+{
+  struct heap_elem *max = heap_max (h);
+  heap_remove (h, max);
+  return max;
+}
+
+/* Removes E, which must be in H, from H. */
+void
+heap_remove (struct heap *h, struct heap_elem *e) 
+{
+  struct heap_elem *last;
+
+  ASSERT (h != NULL);
+  ASSERT (e != NULL);
+  ASSERT (!heap_empty (h));
+
+  /* Detach the element in the last position. */
+  last = elem_at (h, h->size);
+  h->size--;
+  if (last->parent == NULL)
+    {
+      ASSERT (last == e);
+      h->root = NULL;
+      return;
+    }
+  replace_child (h, last->parent, last, NULL);
+  if (last == e)
+    return;
+
+  /* Put it where E was, then restore heap order around it. */
+  last->parent = e->parent;
+  last->left = e->left;
+  last->right = e->right;
+  if (last->left != NULL)
+    last->left->parent = last;
+  if (last->right != NULL)
+    last->right->parent = last;
+  replace_child (h, e->parent, e, last);
+  heap_update (h, last);
+}
+
+/* Restores heap order in H after the key of E, which must be in
+   H, has changed in either direction. */
+void
+heap_update (struct heap *h, struct heap_elem *e) 
+{
+  ASSERT (h != NULL);
+  ASSERT (e != NULL);
+
+  if (e->parent != NULL && h->less (e->parent, e, h->aux))
+    sift_up (h, e);
+  else
+    sift_down (h, e);
+}
+
+/* Returns the element of H at position POS, counting from 1 at
+   the root in breadth-first order. */
+static struct heap_elem *
+elem_at (const struct heap *h, size_t pos) 
+{
+  struct heap_elem *e = h->root;
+  int bit;
+
+  ASSERT (pos >= 1 && pos <= h->size);
+
+  /* Find the most significant bit, then follow the bits below
+     it from the root. */
+  for (bit = 0; (pos >> bit) > 1; bit++)
+    continue;
+  while (--bit >= 0)
+    e = (pos >> bit) & 1 ? e->right : e->left;
+  return e;
+}
+
+/* Makes NEW take OLD's place as a child of PARENT, or as H's
+   root if PARENT is null.  NEW may be null. */
+static void
+replace_child (struct heap *h, struct heap_elem *parent,
+               struct heap_elem *old, struct heap_elem *new) 
+{
+  if (parent == NULL)
+    h->root = new;
+  else if (parent->left == old)
+    parent->left = new;
+  else
+    {
+      ASSERT (parent->right == old);
+      parent->right = new;
+    }
+}
+
+/* Exchanges the positions of PARENT and its child CHILD in H. */
+static void
+swap_with_child (struct heap *h, struct heap_elem *parent,
+                 struct heap_elem *child) 
+{
+  struct heap_elem *grandparent = parent->parent;
+  struct heap_elem *child_left = child->left;
+  struct heap_elem *child_right = child->right;
+
+  if (parent->left == child)
+    {
+      child->left = parent;
+      child->right = parent->right;
+      if (child->right != NULL)
+        child->right->parent = child;
+    }
+  else
+    {
+      child->right = parent;
+      child->left = parent->left;
+      if (child->left != NULL)
+        child->left->parent = child;
+    }
+
+  parent->left = child_left;
+  parent->right = child_right;
+  if (child_left != NULL)
+    child_left->parent = parent;
+  if (child_right != NULL)
+    child_right->parent = parent;
+
+  replace_child (h, grandparent, parent, child);
+  child->parent = grandparent;
+  parent->parent = child;
+}
+
+/* Moves E toward the root of H while it is greater than its
+   parent. */
+static void
+sift_up (struct heap *h, struct heap_elem *e) 
+{
+  while (e->parent != NULL && h->less (e->parent, e, h->aux))
+    swap_with_child (h, e->parent, e);
+}
+
+/* Moves E toward the leaves of H while it is less than one of
+   its children. */
+static void
+sift_down (struct heap *h, struct heap_elem *e) 
+{
+  for (;;)
+    {
+      struct heap_elem *max = e->left;
+      if (max == NULL)
+        break;
+      if (e->right != NULL && h->less (max, e->right, h->aux))
+        max = e->right;
+      if (!h->less (e, max, h->aux))
+        break;
+      swap_with_child (h, e, max);
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef __LIB_KERNEL_HEAP_H
+#define __LIB_KERNEL_HEAP_H
+
+/* Binary max-heap.
+
+   Like the linked list in list.h, this heap does not require
+   use of dynamically allocated memory.  Each structure that can
+   potentially be in a heap must embed a struct heap_elem member,
+   and the heap functions operate on these `struct heap_elem's.
+   The heap_entry macro converts a struct heap_elem back to the
+   structure that contains it.
+
+   The heap is a complete binary tree linked through the
+   elements themselves, rather than an array, so it never needs
+   to grow.  The element at position N, counting from 1 at the
+   root in breadth-first order, is found by following the bits of
+   N below its most significant bit from the root: 0 for the left
+   child, 1 for the right.
+
+   Insertion, removal of the maximum or of an arbitrary element,
+   and re-positioning an element whose key changed all take
+   O(log n) time.  Finding the maximum takes constant time.
+
+   Elements that compare equal come out in no particular order.
+   Callers that need first-in, first-out order among equals, as
+   the semaphore wait queues do, must break ties in their
+   comparison function, e.g. with a sequence number. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct heap_elem 
+  {
+    struct heap_elem *parent;   /* Parent, or null at the root. */
+    struct heap_elem *left;     /* Left child, if any. */
+    struct heap_elem *right;    /* Right child, if any. */
+  };
+
+/* Converts pointer to heap element HEAP_ELEM into a pointer to
+   the structure that HEAP_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the heap element. */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER)                   \
+        ((STRUCT *) ((uint8_t *) &(HEAP_ELEM)->parent           \
+                     - offsetof (STRUCT, MEMBER.parent)))
+
+/* Compares the value of two heap elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool heap_less_func (const struct heap_elem *a,
+                             const struct heap_elem *b,
+                             void *aux);
+
+/* Heap. */
+struct heap 
+  {
+    struct heap_elem *root;     /* Maximum element, or null. */
+    size_t size;                /* Number of elements. */
+    heap_less_func *less;       /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+void heap_init (struct heap *, heap_less_func *, void *aux);
+
+size_t heap_size (const struct heap *);
+bool heap_empty (const struct heap *);
+
+void heap_insert (struct heap *, struct heap_elem *);
+struct heap_elem *heap_max (const struct heap *);
+struct heap_elem *heap_pop_max (struct heap *);
+void heap_remove (struct heap *, struct heap_elem *);
+void heap_update (struct heap *, struct heap_elem *);
+
+#endif /* lib/kernel/heap.h */
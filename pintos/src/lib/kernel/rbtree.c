@@ -0,0 +1,359 @@
+#include "rbtree.h"
+#include "../debug.h"
+
+/* The algorithms follow Cormen et al., "Introduction to
+   Algorithms", chapter 13, with null pointers in place of the
+   sentinel leaf, which is black. */
+
+static void rotate_left (struct rbtree *, struct rb_elem *);
+static void rotate_right (struct rbtree *, struct rb_elem *);
+static void replace_child (struct rbtree *, struct rb_elem *old,
+                           struct rb_elem *new);
+static void insert_fixup (struct rbtree *, struct rb_elem *);
+static void remove_fixup (struct rbtree *, struct rb_elem *,
+                          struct rb_elem *parent);
+static struct rb_elem *leftmost (struct rb_elem *);
+
+/* Returns true if E is a red element, false if it is black or
+   null. */
+static inline bool
+is_red (const struct rb_elem *e)
+{
+  return e != NULL && e->red;
+}
+
+/* Initializes tree T as empty, ordered by LESS given auxiliary
+   data AUX. */
+void
+rb_init (struct rbtree *t, rb_less_func *less, void *aux)
+{
+  ASSERT (t != NULL);
+  ASSERT (less != NULL);
+
+  t->root = t->min = NULL;
+  t->size = 0;
+  t->less = less;
+  t->aux = aux;
+}
+
+/* Returns the number of elements in T. */
+size_t
+rb_size (const struct rbtree *t)
+{
+  return t->size;
+}
+
+/* Returns true if T is empty, false otherwise. */
+bool
+rb_empty (const struct rbtree *t)
+{
+  return t->root == NULL;
+}
+
+/* Inserts E into T, after any elements equal to it. */
+void
+rb_insert (struct rbtree *t, struct rb_elem *e)
+{
+  struct rb_elem *parent = NULL;
+  struct rb_elem **link = &t->root;
+  bool is_min = true;
+
+  ASSERT (t != NULL);
+  ASSERT (e != NULL);
+
+  while (*link != NULL)
+    {
+      parent = *link;
+      if (t->less (e, parent, t->aux))
+        link = &parent->left;
+      else
+        {
+          link = &parent->right;
+          is_min = false;
+        }
+    }
+
+  e->parent = parent;
+  e->left = e->right = NULL;
+  e->red = true;
+  *link = e;
+  if (is_min)
+    t->min = e;
+  t->size++;
+
+  insert_fixup (t, e);
+}
+
+/* Removes E, which must be in T, from T. */
+void
+rb_remove (struct rbtree *t, struct rb_elem *e)
+{
+  struct rb_elem *child, *parent;
+  bool removed_red;
+
+  ASSERT (t != NULL);
+  ASSERT (e != NULL);
+  ASSERT (t->size > 0);
+
+  if (t->min == e)
+    t->min = rb_next (e);
+
+  if (e->left == NULL || e->right == NULL)
+    {
+      /* E has at most one child, which takes its place. */
+      child = e->left != NULL ? e->left : e->right;
+      parent = e->parent;
+      removed_red = e->red;
+      if (child != NULL)
+        child->parent = parent;
+      replace_child (t, e, child);
+    }
+  else
+    {
+      /* E's successor S has no left child.  S moves into E's
+         place, and S's right child into S's place. */
+      struct rb_elem *s = leftmost (e->right);
+
+      child = s->right;
+      removed_red = s->red;
+      if (s->parent == e)
+        parent = s;
+      else
+        {
+          parent = s->parent;
+          parent->left = child;
+          if (child != NULL)
+            child->parent = parent;
+          s->right = e->right;
+          s->right->parent = s;
+        }
+      s->left = e->left;
+      s->left->parent = s;
+      s->parent = e->parent;
+      s->red = e->red;
+      replace_child (t, e, s);
+    }
+  t->size--;
+
+  if (!removed_red)
+    remove_fixup (t, child, parent);
+}
+
+/* Returns the minimum element in T, or a null pointer if T is
+   empty. */
+struct rb_elem *
+rb_min (const struct rbtree *t)
+{
+  return t->min;
+}
+
+/* Removes and returns the minimum element in T, which must not
+   be empty. */
+struct rb_elem *
+rb_pop_min (struct rbtree *t)
+{
+  struct rb_elem *e = t->min;
+
+  ASSERT (e != NULL);
+  rb_remove (t, e);
+  return e;
+}
+
+/* Returns the element that follows E in its tree, or a null
+   pointer if E is the maximum. */
+struct rb_elem *
+rb_next (struct rb_elem *e)
+{
+  ASSERT (e != NULL);
+
+  if (e->right != NULL)
+    return leftmost (e->right);
+  while (e->parent != NULL && e == e->parent->right)
+    e = e->parent;
+  return e->parent;
+}
+
+/* Returns the leftmost element in the subtree rooted at E. */
+static struct rb_elem *
+leftmost (struct rb_elem *e)
+{
+  while (e->left != NULL)
+    e = e->left;
+  return e;
+}
+
+/* Makes NEW take OLD's place as the child of OLD's parent, or as
+   the root of T.  Does not update NEW's parent pointer. */
+static void
+replace_child (struct rbtree *t, struct rb_elem *old, struct rb_elem *new)
+{
+  if (old->parent == NULL)
+    t->root = new;
+  else if (old->parent->left == old)
+    old->parent->left = new;
+  else
+    old->parent->right = new;
+}
+
+/* Rotates the subtree rooted at E to the left, making E's right
+   child its parent. */
+static void
+rotate_left (struct rbtree *t, struct rb_elem *e)
+{
+  struct rb_elem *r = e->right;
+
+  e->right = r->left;
+  if (r->left != NULL)
+    r->left->parent = e;
+  r->parent = e->parent;
+  replace_child (t, e, r);
+  r->left = e;
+  e->parent = r;
+}
+
+/* Rotates the subtree rooted at E to the right, making E's left
+   child its parent. */
+static void
+rotate_right (struct rbtree *t, struct rb_elem *e)
+{
+  struct rb_elem *l = e->left;
+
+  e->left = l->right;
+  if (l->right != NULL)
+    l->right->parent = e;
+  l->parent = e->parent;
+  replace_child (t, e, l);
+  l->right = e;
+  e->parent = l;
+}
+
+/* Restores the red-black properties after inserting red element
+   E, whose parent may also be red. */
+static void
+insert_fixup (struct rbtree *t, struct rb_elem *e)
+{
+  while (is_red (e->parent))
+    {
+      struct rb_elem *p = e->parent;
+      struct rb_elem *g = p->parent;   /* Exists, since P is red. */
+
+      if (p == g->left)
+        {
+          struct rb_elem *u = g->right;
+          if (is_red (u))
+            {
+              p->red = u->red = false;
+              g->red = true;
+              e = g;
+              continue;
+            }
+          if (e == p->right)
+            {
+              rotate_left (t, p);
+              e = p;
+              p = e->parent;
+            }
+          p->red = false;
+          g->red = true;
+          rotate_right (t, g);
+        }
+      else
+        {
+          struct rb_elem *u = g->left;
+          if (is_red (u))
+            {
+              p->red = u->red = false;
+              g->red = true;
+              e = g;
+              continue;
+            }
+          if (e == p->left)
+            {
+              rotate_right (t, p);
+              e = p;
+              p = e->parent;
+            }
+          p->red = false;
+          g->red = true;
+          rotate_left (t, g);
+        }
+    }
+  t->root->red = false;
+}
+
+/* Restores the red-black properties after removing a black
+   element, whose place was taken by E (possibly null) as a child
+   of PARENT.  The path through E is one black element short. */
+static void
+remove_fixup (struct rbtree *t, struct rb_elem *e, struct rb_elem *parent)
+{
+  while (e != t->root && !is_red (e))
+    {
+      if (e == parent->left)
+        {
+          struct rb_elem *w = parent->right;
+          if (is_red (w))
+            {
+              w->red = false;
+              parent->red = true;
+              rotate_left (t, parent);
+              w = parent->right;
+            }
+          if (!is_red (w->left) && !is_red (w->right))
+            {
+              w->red = true;
+              e = parent;
+              parent = e->parent;
+            }
+          else
+            {
+              if (!is_red (w->right))
+                {
+                  w->left->red = false;
+                  w->red = true;
+                  rotate_right (t, w);
+                  w = parent->right;
+                }
+              w->red = parent->red;
+              parent->red = false;
+              w->right->red = false;
+              rotate_left (t, parent);
+              e = t->root;
+            }
+        }
+      else
+        {
+          struct rb_elem *w = parent->left;
+          if (is_red (w))
+            {
+              w->red = false;
+              parent->red = true;
+              rotate_right (t, parent);
+              w = parent->left;
+            }
+          if (!is_red (w->left) && !is_red (w->right))
+            {
+              w->red = true;
+              e = parent;
+              parent = e->parent;
+            }
+          else
+            {
+              if (!is_red (w->left))
+                {
+                  w->right->red = false;
+                  w->red = true;
+                  rotate_left (t, w);
+                  w = parent->left;
+                }
+              w->red = parent->red;
+              parent->red = false;
+              w->left->red = false;
+              rotate_right (t, parent);
+              e = t->root;
+            }
+        }
+    }
+  if (e != NULL)
+    e->red = false;
+}
@@ -0,0 +1,72 @@
+#ifndef __LIB_KERNEL_RBTREE_H
+#define __LIB_KERNEL_RBTREE_H
+
+/* Red-black tree.
+
+   Like the linked list in list.h, this tree does not require
+   use of dynamically allocated memory.  Each structure that can
+   potentially be in a tree must embed a struct rb_elem member,
+   and the tree functions operate on these `struct rb_elem's.
+   The rb_entry macro converts a struct rb_elem back to the
+   structure that contains it.
+
+   The tree is a binary search tree ordered by a caller-supplied
+   comparison function, kept balanced by the usual red-black
+   rules, so that insertion and removal take O(log n) time.  The
+   minimum element is cached, so finding it takes constant time,
+   which suits a queue ordered by key.
+
+   Elements that compare equal may be inserted.  Each goes after
+   the equal elements already in the tree, so equals come out of
+   rb_min() and rb_next() in first-in, first-out order. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Tree element. */
+struct rb_elem
+  {
+    struct rb_elem *parent;     /* Parent, or null at the root. */
+    struct rb_elem *left;       /* Left child, or null. */
+    struct rb_elem *right;      /* Right child, or null. */
+    bool red;                   /* Red or black? */
+  };
+
+/* Converts pointer to tree element RB_ELEM into a pointer to the
+   structure that RB_ELEM is embedded inside.  Supply the name of
+   the outer structure STRUCT and the member name MEMBER of the
+   tree element. */
+#define rb_entry(RB_ELEM, STRUCT, MEMBER)                       \
+        ((STRUCT *) ((uint8_t *) &(RB_ELEM)->parent             \
+                     - offsetof (STRUCT, MEMBER.parent)))
+
+/* Compares the value of two tree elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool rb_less_func (const struct rb_elem *a,
+                           const struct rb_elem *b,
+                           void *aux);
+
+/* Red-black tree. */
+struct rbtree
+  {
+    struct rb_elem *root;       /* Root, or null if empty. */
+    struct rb_elem *min;        /* Minimum element, or null. */
+    size_t size;                /* Number of elements. */
+    rb_less_func *less;         /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+void rb_init (struct rbtree *, rb_less_func *, void *aux);
+
+size_t rb_size (const struct rbtree *);
+bool rb_empty (const struct rbtree *);
+
+void rb_insert (struct rbtree *, struct rb_elem *);
+void rb_remove (struct rbtree *, struct rb_elem *);
+struct rb_elem *rb_min (const struct rbtree *);
+struct rb_elem *rb_pop_min (struct rbtree *);
+struct rb_elem *rb_next (struct rb_elem *);
+
+#endif /* lib/kernel/rbtree.h */
@@ -0,0 +1,24 @@
+#ifndef __LIB_RUSAGE_H
+#define __LIB_RUSAGE_H
+
+#include <stdint.h>
+
+/* CPU accounting for one thread, as returned by getrusage().
+
+   Ticks are timer ticks, charged to whichever thread was running
+   when the timer interrupt arrived, as user time if it
+   interrupted user code and kernel time otherwise.  Waiting
+   times are in CPU cycles, as read from the time-stamp counter,
+   so that they are meaningful even when shorter than a tick. */
+struct rusage
+  {
+    uint64_t user_ticks;        /* Ticks spent running user code. */
+    uint64_t kernel_ticks;      /* Ticks spent running in the kernel. */
+    uint32_t voluntary_switches;   /* Blocked or yielded the CPU. */
+    uint32_t involuntary_switches; /* Preempted. */
+    uint64_t runq_cycles;       /* Time ready but not running. */
+    uint64_t runq_max_cycles;   /* Longest single wait to run. */
+    uint64_t blocked_cycles;    /* Time blocked. */
+  };
+
+#endif /* lib/rusage.h */
@@ -28,7 +28,14 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_GETDENTS,               /* Reads a batch of directory entries. */
+    SYS_FALLOCATE,              /* Reserves disk space for a file. */
+    SYS_GETRUSAGE,              /* Reports CPU accounting. */
+    SYS_SCHED_SETDEADLINE,      /* Joins the EDF scheduling class. */
+    SYS_SCHED_YIELD             /* Yields, ending an EDF job. */
   };
 
 #endif /* lib/syscall-nr.h */
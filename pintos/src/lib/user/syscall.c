@@ -182,3 +182,33 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+int
+getdents (int fd, struct dirent *entries, unsigned size) 
+{
+  return syscall3 (SYS_GETDENTS, fd, entries, size);
+}
+
+bool
+fallocate (int fd, unsigned offset, unsigned length) 
+{
+  return syscall3 (SYS_FALLOCATE, fd, offset, length);
+}
+
+void
+getrusage (struct rusage *usage) 
+{
+  syscall1 (SYS_GETRUSAGE, usage);
+}
+
+bool
+sched_setdeadline (unsigned runtime, unsigned period, unsigned deadline) 
+{
+  return syscall3 (SYS_SCHED_SETDEADLINE, runtime, period, deadline);
+}
+
+bool
+sched_yield (void) 
+{
+  return syscall0 (SYS_SCHED_YIELD);
+}
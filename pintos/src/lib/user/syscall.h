@@ -3,6 +3,8 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <dirent.h>
+#include <rusage.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -45,4 +47,11 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+int getdents (int fd, struct dirent *, unsigned size);
+bool fallocate (int fd, unsigned offset, unsigned length);
+void getrusage (struct rusage *);
+bool sched_setdeadline (unsigned runtime, unsigned period, unsigned deadline);
+bool sched_yield (void);
+
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,138 @@
+/* Ages a 4 MB file system, then measures allocation on it.
+   First fills the disk with files of random sizes, then several
+   times removes a random third of them and refills the disk to
+   85% with new files, which leaves the free space scattered in
+   small pieces.  Finally writes a few larger files, bringing the
+   disk to about 90% full, and checks their contents.
+
+   The free map statistics printed at power off give the cycles
+   per allocation, the bitmap positions scanned, and how many
+   allocations continued contiguously from the one before, which
+   is how often a file's sectors landed next to each other. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Most files alive at once. */
+#define MAX_FILES 1024
+
+/* Aging files are 1 to AGE_MAX_SECTORS sectors long. */
+#define AGE_MAX_SECTORS 32
+
+/* Number of rounds of removing and refilling. */
+#define AGE_ROUNDS 4
+
+/* Files written after aging, and their size. */
+#define MEASURE_FILES 8
+#define MEASURE_SIZE (24 * 1024)
+
+static char buf[MEASURE_SIZE];
+
+/* Size of each file that is alive, or 0. */
+static size_t sizes[MAX_FILES];
+
+/* Bytes in all the files alive. */
+static size_t live_bytes;
+
+/* Creates file number IDX with SIZE bytes of BUF.  Returns true
+   if successful, false if the disk filled up, in which case the
+   file is removed again. */
+static bool
+make_file (int idx, size_t size)
+{
+  char name[16];
+  bool ok;
+  int fd;
+
+  snprintf (name, sizeof name, "f%d", idx);
+  if (!create (name, 0))
+    return false;
+  fd = open (name);
+  if (fd < 2)
+    fail ("open \"%s\" failed", name);
+  ok = write (fd, buf, size) == (int) size;
+  close (fd);
+  if (!ok)
+    {
+      remove (name);
+      return false;
+    }
+  sizes[idx] = size;
+  live_bytes += size;
+  return true;
+}
+
+/* Removes file number IDX. */
+static void
+remove_file (int idx)
+{
+  char name[16];
+
+  snprintf (name, sizeof name, "f%d", idx);
+  if (!remove (name))
+    fail ("remove \"%s\" failed", name);
+  live_bytes -= sizes[idx];
+  sizes[idx] = 0;
+}
+
+/* Creates files of random sizes in free slots until LIMIT bytes
+   are alive or the disk is full. */
+static void
+refill (size_t limit)
+{
+  int idx;
+
+  for (idx = 0; idx < MAX_FILES && live_bytes < limit; idx++)
+    if (sizes[idx] == 0)
+      {
+        size_t size = (random_ulong () % AGE_MAX_SECTORS + 1) * 512;
+        if (!make_file (idx, size))
+          break;
+      }
+}
+
+void
+test_main (void)
+{
+  size_t capacity;
+  int round, idx;
+
+  random_init (0);
+
+  msg ("fill disk");
+  refill ((size_t) -1);
+  capacity = live_bytes;
+
+  msg ("age disk");
+  for (round = 0; round < AGE_ROUNDS; round++)
+    {
+      for (idx = 0; idx < MAX_FILES; idx++)
+        if (sizes[idx] != 0 && random_ulong () % 3 == 0)
+          remove_file (idx);
+      refill (capacity / 100 * 85);
+    }
+
+  /* Make room for the measured files in the highest slots. */
+  for (idx = MAX_FILES - MEASURE_FILES; idx < MAX_FILES; idx++)
+    if (sizes[idx] != 0)
+      remove_file (idx);
+
+  msg ("write %d files of %d bytes", MEASURE_FILES, MEASURE_SIZE);
+  random_bytes (buf, sizeof buf);
+  for (idx = MAX_FILES - MEASURE_FILES; idx < MAX_FILES; idx++)
+    if (!make_file (idx, MEASURE_SIZE))
+      fail ("write f%d failed", idx);
+
+  msg ("verify %d files", MEASURE_FILES);
+  for (idx = MAX_FILES - MEASURE_FILES; idx < MAX_FILES; idx++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "f%d", idx);
+      quiet = true;
+      check_file (name, buf, MEASURE_SIZE);
+      quiet = false;
+    }
+}
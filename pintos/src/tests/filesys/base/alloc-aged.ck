@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(alloc-aged) begin
+(alloc-aged) fill disk
+(alloc-aged) age disk
+(alloc-aged) write 8 files of 24576 bytes
+(alloc-aged) verify 8 files
+(alloc-aged) end
+EOF
+
+# Each search resumes at its allocation group's cursor, just past
+# the group's last allocation, so even on the nearly full disk an
+# allocation examines far fewer positions than a group holds.
+# Searching from sector 0 each time would cross most of the disk.
+my ($stats) = grep (/^Free map: .* positions scanned/,
+		    read_text_file ("$test.output"));
+fail "No free map statistics.\n" if !defined $stats;
+my ($allocs, $scanned) = $stats =~ /(\d+) allocations, .* (\d+) positions scanned/
+  or fail "Can't parse free map statistics: $stats\n";
+fail "$scanned positions scanned for $allocs allocations, "
+  . "more than 1024 per allocation.\n"
+  if $scanned > 1024 * $allocs;
+pass;
@@ -0,0 +1,47 @@
+/* Child process for syn-rand-read test.
+   Reads randomly chosen sectors of the test file and checks
+   their contents. */
+
+#include <random.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/filesys/base/syn-rand-read.h"
+
+const char *test_name = "child-rand-read";
+
+static char buf[BUF_SIZE];
+
+int
+main (int argc, const char *argv[]) 
+{
+  char block[READ_SIZE];
+  int child_idx;
+  int fd;
+  int i;
+
+  quiet = true;
+  
+  CHECK (argc == 2, "argc must be 2, actually %d", argc);
+  child_idx = atoi (argv[1]);
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  /* Each child visits the sectors in its own order. */
+  random_init (child_idx + 1);
+
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  for (i = 0; i < READ_CNT; i++) 
+    {
+      size_t ofs = random_ulong () % (BUF_SIZE / READ_SIZE) * READ_SIZE;
+      seek (fd, ofs);
+      CHECK (read (fd, block, READ_SIZE) == READ_SIZE,
+             "read \"%s\"", file_name);
+      compare_bytes (block, buf + ofs, READ_SIZE, ofs, file_name);
+    }
+  close (fd);
+
+  return child_idx;
+}
@@ -0,0 +1,60 @@
+/* Creates and removes several large files without writing them,
+   then writes one byte at the end of one of them.  Files start
+   out as holes, so creating one costs a constant number of disk
+   writes however large it is; the block device write counts
+   printed at power off show the difference.  Also checks that
+   the unwritten parts read back as zeros. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 8
+#define FILE_SIZE (1024 * 1024)
+
+static char buf[4096];
+
+void
+test_main (void) 
+{
+  char name[16];
+  char one = 1;
+  size_t ofs;
+  int fd, i;
+
+  msg ("create and remove %d files of %d bytes", FILE_CNT, FILE_SIZE);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "sparse%d", i);
+      if (!create (name, FILE_SIZE))
+        fail ("create \"%s\" failed", name);
+      if (!remove (name))
+        fail ("remove \"%s\" failed", name);
+    }
+
+  CHECK (create ("sparse", FILE_SIZE), "create \"sparse\"");
+  CHECK ((fd = open ("sparse")) > 1, "open \"sparse\"");
+  CHECK (filesize (fd) == FILE_SIZE, "filesize \"sparse\"");
+
+  msg ("write last byte of \"sparse\"");
+  seek (fd, FILE_SIZE - 1);
+  if (write (fd, &one, 1) != 1)
+    fail ("write \"sparse\" failed");
+
+  msg ("read \"sparse\"");
+  seek (fd, 0);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += sizeof buf)
+    {
+      size_t j;
+
+      if (read (fd, buf, sizeof buf) != (int) sizeof buf)
+        fail ("read \"sparse\" at offset %zu failed", ofs);
+      for (j = 0; j < sizeof buf; j++)
+        if (buf[j] != (ofs + j == FILE_SIZE - 1 ? 1 : 0))
+          fail ("byte %zu of \"sparse\" is %d", ofs + j, buf[j]);
+    }
+
+  msg ("close \"sparse\"");
+  close (fd);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(create-sparse) begin
+(create-sparse) create and remove 8 files of 1048576 bytes
+(create-sparse) create "sparse"
+(create-sparse) open "sparse"
+(create-sparse) filesize "sparse"
+(create-sparse) write last byte of "sparse"
+(create-sparse) read "sparse"
+(create-sparse) close "sparse"
+(create-sparse) end
+EOF
+pass;
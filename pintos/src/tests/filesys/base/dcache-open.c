@@ -0,0 +1,44 @@
+/* Repeatedly opens and closes the same handful of files, and
+   probes a name that does not exist, to exercise the directory
+   entry cache.  The kernel's "Dcache:" statistics line printed
+   at power off shows how many of the lookups were hits. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 4
+#define ITERATIONS 100
+
+void
+test_main (void) 
+{
+  char file_name[FILE_CNT][16];
+  int i, j;
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (file_name[i], sizeof file_name[i], "file%d", i);
+      CHECK (create (file_name[i], 0), "create \"%s\"", file_name[i]);
+    }
+
+  msg ("open each file %d times", ITERATIONS);
+  for (j = 0; j < ITERATIONS; j++)
+    for (i = 0; i < FILE_CNT; i++)
+      {
+        int fd = open (file_name[i]);
+        if (fd < 2)
+          fail ("open \"%s\" failed", file_name[i]);
+        close (fd);
+      }
+
+  msg ("probe \"nonexistent\" %d times", ITERATIONS);
+  for (j = 0; j < ITERATIONS; j++)
+    if (open ("nonexistent") != -1)
+      fail ("open \"nonexistent\" succeeded");
+
+  CHECK (remove (file_name[0]), "remove \"%s\"", file_name[0]);
+  CHECK (open (file_name[0]) == -1, "open \"%s\" after removal",
+         file_name[0]);
+}
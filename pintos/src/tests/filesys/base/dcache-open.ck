@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dcache-open) begin
+(dcache-open) create "file0"
+(dcache-open) create "file1"
+(dcache-open) create "file2"
+(dcache-open) create "file3"
+(dcache-open) open each file 100 times
+(dcache-open) probe "nonexistent" 100 times
+(dcache-open) remove "file0"
+(dcache-open) open "file0" after removal
+(dcache-open) end
+EOF
+pass;
@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(falloc-seq) begin
+(falloc-seq) create "append-a"
+(falloc-seq) create "append-b"
+(falloc-seq) open "append-a"
+(falloc-seq) open "append-b"
+(falloc-seq) write "append-a" and "append-b" in turn
+(falloc-seq) create "falloc-a"
+(falloc-seq) create "falloc-b"
+(falloc-seq) open "falloc-a"
+(falloc-seq) open "falloc-b"
+(falloc-seq) fallocate "falloc-a"
+(falloc-seq) fallocate "falloc-b"
+(falloc-seq) filesize "falloc-a"
+(falloc-seq) read "falloc-a" before writing
+(falloc-seq) write "falloc-a" and "falloc-b" in turn
+(falloc-seq) open "append-a"
+(falloc-seq) open "append-b"
+(falloc-seq) open "falloc-a"
+(falloc-seq) open "falloc-b"
+(falloc-seq) end
+EOF
+pass;
@@ -0,0 +1,85 @@
+/* Creates a directory of 5,000 files, then lists it twice:
+   with getdents() filling a buffer of many entries per call,
+   and with a buffer that holds only one entry, which costs a
+   system call per entry like readdir().  Checks that each
+   listing returns every file exactly once.  The block device
+   counts printed at power off show the cost of each. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 5000
+#define BATCH_CNT 64
+
+static struct dirent entries[BATCH_CNT];
+static char seen[FILE_CNT];
+
+/* Lists directory FD from the start, BATCH entries per call,
+   and checks that every file we created shows up once. */
+static void
+list (int fd, size_t batch) 
+{
+  int cnt, i;
+
+  memset (seen, 0, sizeof seen);
+  seek (fd, 0);
+  while ((cnt = getdents (fd, entries, batch * sizeof *entries)) > 0)
+    {
+      if (cnt > (int) batch)
+        fail ("getdents returned %d entries, buffer holds %zu", cnt, batch);
+      for (i = 0; i < cnt; i++)
+        {
+          const struct dirent *d = &entries[i];
+          int idx;
+
+          /* Skip files that are not ours, such as this test. */
+          if (d->d_name[0] != 'f')
+            continue;
+          idx = atoi (d->d_name + 1);
+          if (idx < 0 || idx >= FILE_CNT)
+            fail ("unexpected entry \"%s\"", d->d_name);
+          if (seen[idx])
+            fail ("entry \"%s\" listed twice", d->d_name);
+          if (d->d_type != DT_REG)
+            fail ("entry \"%s\" has type %d", d->d_name, d->d_type);
+          seen[idx] = 1;
+        }
+    }
+  if (cnt < 0)
+    fail ("getdents failed");
+
+  for (i = 0; i < FILE_CNT; i++)
+    if (!seen[i])
+      fail ("entry \"f%d\" missing", i);
+}
+
+void
+test_main (void) 
+{
+  char name[16];
+  int fd, i;
+
+  msg ("create %d files", FILE_CNT);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "f%d", i);
+      if (!create (name, 0))
+        fail ("create \"%s\" failed", name);
+    }
+
+  CHECK ((fd = open ("/")) > 1, "open \"/\"");
+  CHECK (isdir (fd), "isdir \"/\"");
+
+  msg ("list %d entries per call", BATCH_CNT);
+  list (fd, BATCH_CNT);
+
+  msg ("list 1 entry per call");
+  list (fd, 1);
+
+  msg ("close \"/\"");
+  close (fd);
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(getdents-lg) begin
+(getdents-lg) create 5000 files
+(getdents-lg) open "/"
+(getdents-lg) isdir "/"
+(getdents-lg) list 64 entries per call
+(getdents-lg) list 1 entry per call
+(getdents-lg) close "/"
+(getdents-lg) end
+EOF
+pass;
@@ -0,0 +1,5 @@
+/* Same as seq-read, but with the file system on md0 striped
+   over hdc and hdd, which share the secondary IDE channel, as a
+   baseline for seq-read-md0. */
+
+#include "tests/filesys/base/seq-read.inc"
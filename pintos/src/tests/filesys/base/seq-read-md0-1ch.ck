@@ -0,0 +1,28 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(seq-read-md0-1ch) begin
+(seq-read-md0-1ch) create "seq-read"
+(seq-read-md0-1ch) open "seq-read"
+(seq-read-md0-1ch) write "seq-read"
+(seq-read-md0-1ch) read "seq-read" 8 times
+(seq-read-md0-1ch) close "seq-read"
+(seq-read-md0-1ch) end
+EOF
+
+# A request that spans several stripe units should reach each of
+# the 2 members as a single request.
+my ($stats) = grep (/^md0: .* member requests/,
+		    read_text_file ("$test.output"));
+fail "No md0 statistics.\n" if !defined $stats;
+my ($requests, $striped, $member_requests)
+  = $stats =~ /(\d+) requests, (\d+) striped, (\d+) member requests/
+  or fail "Can't parse md0 statistics: $stats\n";
+fail "No request spanned more than one stripe unit.\n" if $striped == 0;
+fail "$striped striped requests took $member_requests member requests "
+  . "in all, more than 2 each.\n"
+  if $member_requests > $requests + $striped;
+pass;
@@ -0,0 +1,4 @@
+/* Same as seq-read, but with the file system on md0 striped
+   over hdb and hdc, which sit on different IDE channels. */
+
+#include "tests/filesys/base/seq-read.inc"
@@ -0,0 +1,48 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(seq-read-md0) begin
+(seq-read-md0) create "seq-read"
+(seq-read-md0) open "seq-read"
+(seq-read-md0) write "seq-read"
+(seq-read-md0) read "seq-read" 8 times
+(seq-read-md0) close "seq-read"
+(seq-read-md0) end
+EOF
+
+# Returns the request count, striped request count, member
+# request count, and cycles spent in striped requests from the
+# md0 statistics in the output of test $run.
+sub md0_stats {
+    my ($run) = @_;
+    my ($stats) = grep (/^md0: .* member requests/,
+			read_text_file ("$run.output"));
+    fail "$run: no md0 statistics.\n" if !defined $stats;
+    my (@stats) = $stats =~ /(\d+) requests, (\d+) striped, (\d+) member requests, (\d+) cycles/
+      or fail "$run: can't parse md0 statistics: $stats\n";
+    return @stats;
+}
+
+# A request that spans several stripe units should reach each of
+# the 2 members as a single request.
+my ($requests, $striped, $member_requests, $cycles) = md0_stats ($test);
+fail "No request spanned more than one stripe unit.\n" if $striped == 0;
+fail "$striped striped requests took $member_requests member requests "
+  . "in all, more than 2 each.\n"
+  if $member_requests > $requests + $striped;
+
+# With the members on separate channels, both halves of a striped
+# request transfer at once, so on average it should finish sooner
+# than with both members on one channel.
+my (undef, $striped_1ch, undef, $cycles_1ch) = md0_stats ("$test-1ch");
+fail "No request spanned more than one stripe unit with one channel.\n"
+  if $striped_1ch == 0;
+my ($avg) = int ($cycles / $striped);
+my ($avg_1ch) = int ($cycles_1ch / $striped_1ch);
+fail "Striped requests took $avg cycles on average over two channels, "
+  . "no faster than $avg_1ch over one.\n"
+  if $avg >= $avg_1ch;
+pass;
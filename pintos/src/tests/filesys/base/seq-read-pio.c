@@ -0,0 +1,5 @@
+/* Same as seq-read, but with the kernel told by -nodma to move
+   disk data by PIO, for comparing CPU time per MB read against
+   DMA transfers. */
+
+#include "tests/filesys/base/seq-read.inc"
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(seq-read-pio) begin
+(seq-read-pio) create "seq-read"
+(seq-read-pio) open "seq-read"
+(seq-read-pio) write "seq-read"
+(seq-read-pio) read "seq-read" 8 times
+(seq-read-pio) close "seq-read"
+(seq-read-pio) end
+EOF
+pass;
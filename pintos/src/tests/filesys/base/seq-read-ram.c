@@ -0,0 +1,4 @@
+/* Same as seq-read, but with the file system on a RAM disk
+   created by -ramdisk, as a baseline free of disk latency. */
+
+#include "tests/filesys/base/seq-read.inc"
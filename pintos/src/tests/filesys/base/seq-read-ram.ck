@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(seq-read-ram) begin
+(seq-read-ram) create "seq-read"
+(seq-read-ram) open "seq-read"
+(seq-read-ram) write "seq-read"
+(seq-read-ram) read "seq-read" 8 times
+(seq-read-ram) close "seq-read"
+(seq-read-ram) end
+EOF
+pass;
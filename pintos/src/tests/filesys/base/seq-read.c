@@ -0,0 +1,9 @@
+/* Writes a large file, then reads it back sequentially several
+   times in big chunks, 1 MB in total.  Its physically consecutive
+   sectors should reach the disk as multi-sector requests; the
+   "reads in N requests" statistics printed at power off show
+   how well they were merged.  The kernel tick counts printed
+   there, compared with those of seq-read-pio, give the CPU time
+   spent per MB read with and without DMA. */
+
+#include "tests/filesys/base/seq-read.inc"
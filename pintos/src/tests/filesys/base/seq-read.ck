@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(seq-read) begin
+(seq-read) create "seq-read"
+(seq-read) open "seq-read"
+(seq-read) write "seq-read"
+(seq-read) read "seq-read" 8 times
+(seq-read) close "seq-read"
+(seq-read) end
+EOF
+pass;
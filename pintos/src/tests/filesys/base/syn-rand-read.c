@@ -0,0 +1,35 @@
+/* Spawns 8 child processes, all of which read random sectors of
+   the same file at the same time and make sure that the contents
+   are what they should be.  Keeps several requests queued at the
+   disk, so that the elevator has something to sort; the IDE
+   statistics printed at power off report the head travel, peak
+   queue length and worst request latency. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/filesys/base/syn-rand-read.h"
+
+static char buf[BUF_SIZE];
+
+#define CHILD_CNT 8
+
+void
+test_main (void) 
+{
+  pid_t children[CHILD_CNT];
+  int fd;
+
+  CHECK (create (file_name, sizeof buf), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+  CHECK (write (fd, buf, sizeof buf) > 0, "write \"%s\"", file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+
+  exec_children ("child-rand-read", children, CHILD_CNT);
+  wait_children (children, CHILD_CNT);
+}
@@ -0,0 +1,52 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(syn-rand-read) begin
+(syn-rand-read) create "data"
+(syn-rand-read) open "data"
+(syn-rand-read) write "data"
+(syn-rand-read) close "data"
+(syn-rand-read) exec child 1 of 8: "child-rand-read 0"
+(syn-rand-read) exec child 2 of 8: "child-rand-read 1"
+(syn-rand-read) exec child 3 of 8: "child-rand-read 2"
+(syn-rand-read) exec child 4 of 8: "child-rand-read 3"
+(syn-rand-read) exec child 5 of 8: "child-rand-read 4"
+(syn-rand-read) exec child 6 of 8: "child-rand-read 5"
+(syn-rand-read) exec child 7 of 8: "child-rand-read 6"
+(syn-rand-read) exec child 8 of 8: "child-rand-read 7"
+(syn-rand-read) wait for child 1 of 8 returned 0 (expected 0)
+(syn-rand-read) wait for child 2 of 8 returned 1 (expected 1)
+(syn-rand-read) wait for child 3 of 8 returned 2 (expected 2)
+(syn-rand-read) wait for child 4 of 8 returned 3 (expected 3)
+(syn-rand-read) wait for child 5 of 8 returned 4 (expected 4)
+(syn-rand-read) wait for child 6 of 8 returned 5 (expected 5)
+(syn-rand-read) wait for child 7 of 8 returned 6 (expected 6)
+(syn-rand-read) wait for child 8 of 8 returned 7 (expected 7)
+(syn-rand-read) end
+EOF
+
+# The file system disk is on ide0.  With 8 children reading random
+# sectors at once, requests queue up there, and serving them in
+# C-LOOK order should move the head less than serving them in
+# arrival order.  C-LOOK also sweeps in one direction only, so no
+# request waits for more than about two sweeps of the queue.
+my ($stats) = grep (/^ide0: .* head travel/, read_text_file ("$test.output"));
+fail "No ide0 statistics.\n" if !defined $stats;
+my ($travel, $fifo_travel, $peak_queue, $max_latency, $max_service)
+  = $stats =~ /(\d+) sectors of head travel \((\d+) in arrival order\), peak queue (\d+), max latency (\d+) ticks, max service (\d+) ticks/
+  or fail "Can't parse ide0 statistics: $stats\n";
+fail "Peak queue length was $peak_queue, too short for the elevator "
+  . "to sort anything.\n"
+  if $peak_queue < 2;
+fail "Head traveled $travel sectors, no less than the $fifo_travel "
+  . "it would have in arrival order.\n"
+  if $travel >= $fifo_travel;
+my ($latency_bound) = 2 * $peak_queue * ($max_service + 1);
+fail "Max latency was $max_latency ticks, more than $latency_bound, "
+  . "2 sweeps of a $peak_queue-request queue at $max_service ticks "
+  . "per request.\n"
+  if $max_latency > $latency_bound;
+pass;
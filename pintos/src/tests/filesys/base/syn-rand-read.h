@@ -0,0 +1,9 @@
+#ifndef TESTS_FILESYS_BASE_SYN_RAND_READ_H
+#define TESTS_FILESYS_BASE_SYN_RAND_READ_H
+
+#define BUF_SIZE (64 * 1024)
+#define READ_SIZE 512
+#define READ_CNT 200
+static const char file_name[] = "data";
+
+#endif /* tests/filesys/base/syn-rand-read.h */
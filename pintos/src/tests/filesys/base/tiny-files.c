@@ -0,0 +1,76 @@
+/* Creates, writes and reads back many tiny files, then grows one
+   of them well past the size that fits inside its inode.  Tiny
+   files keep their data inside the inode, so each costs one
+   sector and one read to access; the block device counts printed
+   at power off show the difference. */
+
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 32
+#define FILE_SIZE 100
+#define GROWN_SIZE 1000
+
+static char data[FILE_CNT][FILE_SIZE];
+static char buf[GROWN_SIZE];
+
+void
+test_main (void) 
+{
+  char name[16];
+  int fd, i;
+
+  random_bytes (data, sizeof data);
+
+  msg ("create and write %d files of %d bytes", FILE_CNT, FILE_SIZE);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "tiny%d", i);
+      if (!create (name, 0))
+        fail ("create \"%s\" failed", name);
+      if ((fd = open (name)) < 2)
+        fail ("open \"%s\" failed", name);
+      if (write (fd, data[i], FILE_SIZE) != FILE_SIZE)
+        fail ("write \"%s\" failed", name);
+      close (fd);
+    }
+
+  msg ("read back %d files", FILE_CNT);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "tiny%d", i);
+      if ((fd = open (name)) < 2)
+        fail ("open \"%s\" failed", name);
+      if (filesize (fd) != FILE_SIZE)
+        fail ("\"%s\" is %d bytes, expected %d",
+              name, filesize (fd), FILE_SIZE);
+      if (read (fd, buf, sizeof buf) != FILE_SIZE)
+        fail ("read \"%s\" failed", name);
+      compare_bytes (buf, data[i], FILE_SIZE, 0, name);
+      close (fd);
+    }
+
+  CHECK ((fd = open ("tiny0")) > 1, "open \"tiny0\"");
+  msg ("grow \"tiny0\" to %d bytes", GROWN_SIZE);
+  seek (fd, GROWN_SIZE - FILE_SIZE);
+  if (write (fd, data[1], FILE_SIZE) != FILE_SIZE)
+    fail ("write \"tiny0\" failed");
+
+  msg ("read \"tiny0\"");
+  seek (fd, 0);
+  if (read (fd, buf, sizeof buf) != GROWN_SIZE)
+    fail ("read \"tiny0\" failed");
+  compare_bytes (buf, data[0], FILE_SIZE, 0, "tiny0");
+  for (i = FILE_SIZE; i < GROWN_SIZE - FILE_SIZE; i++)
+    if (buf[i] != 0)
+      fail ("byte %d of \"tiny0\" is %d", i, buf[i]);
+  compare_bytes (buf + GROWN_SIZE - FILE_SIZE, data[1], FILE_SIZE,
+                 GROWN_SIZE - FILE_SIZE, "tiny0");
+
+  msg ("close \"tiny0\"");
+  close (fd);
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(tiny-files) begin
+(tiny-files) create and write 32 files of 100 bytes
+(tiny-files) read back 32 files
+(tiny-files) open "tiny0"
+(tiny-files) grow "tiny0" to 1000 bytes
+(tiny-files) read "tiny0"
+(tiny-files) close "tiny0"
+(tiny-files) end
+EOF
+pass;
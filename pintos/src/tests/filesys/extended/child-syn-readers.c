@@ -0,0 +1,49 @@
+/* Child process for syn-readers.
+   Reads the file written by our parent process READ_CNT times,
+   one sector-sized chunk at a time, while its siblings do the
+   same, and checks every chunk. */
+
+#include <random.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/filesys/extended/syn-readers.h"
+#include "tests/lib.h"
+
+const char *test_name = "child-syn-readers";
+
+static char buf1[BUF_SIZE];
+static char buf2[CHUNK_SIZE];
+
+int
+main (int argc, const char *argv[]) 
+{
+  int child_idx;
+  int fd;
+  int i;
+
+  quiet = true;
+  
+  CHECK (argc == 2, "argc must be 2, actually %d", argc);
+  child_idx = atoi (argv[1]);
+
+  random_init (0);
+  random_bytes (buf1, sizeof buf1);
+
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  for (i = 0; i < READ_CNT; i++) 
+    {
+      size_t ofs;
+
+      seek (fd, 0);
+      for (ofs = 0; ofs < BUF_SIZE; ofs += CHUNK_SIZE)
+        {
+          CHECK (read (fd, buf2, CHUNK_SIZE) == CHUNK_SIZE,
+                 "read %d bytes at offset %zu in \"%s\"",
+                 CHUNK_SIZE, ofs, file_name);
+          compare_bytes (buf2, buf1 + ofs, CHUNK_SIZE, ofs, file_name);
+        }
+    }
+  close (fd);
+
+  return child_idx;
+}
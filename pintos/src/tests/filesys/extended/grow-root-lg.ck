@@ -3,6 +3,7 @@ use strict;
 use warnings;
 use tests::tests;
 use tests::random;
+our ($test);
 check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
 (grow-root-lg) begin
 (grow-root-lg) creating and checking "file0"
@@ -57,4 +58,19 @@ check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
 (grow-root-lg) creating and checking "file49"
 (grow-root-lg) end
 EOF
+
+# Rewriting the whole free map at each flush would write every one
+# of its sectors each time.  Creating files near each other dirties
+# only one or two of them.
+my ($stats) = grep (/^Free map: .* written back/,
+		    read_text_file ("$test.output"));
+fail "No free map statistics.\n" if !defined $stats;
+my ($written, $flushes, $size)
+  = $stats =~ /(\d+) sectors written back in (\d+) flushes, (\d+) sectors long/
+  or fail "Can't parse free map statistics: $stats\n";
+fail "Free map is only $size sectors long, too short to tell.\n"
+  if $size < 4;
+fail "$written free map sectors written in $flushes flushes, "
+  . "more than 2 per flush.\n"
+  if $written > 2 * $flushes;
 pass;
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my (%actual) = read_tar ("$prereq_tests[0].tar");
+
+# Files were created in order, so after recovery exactly file0
+# through file(N-1) must exist for some N, and all must be empty.
+my ($cnt) = 0;
+$cnt++ while exists $actual{"file$cnt"};
+fail "only $cnt files survived the crash, not file0 through file3\n"
+  if $cnt < 4;
+foreach my $name (sort keys %actual) {
+    next if $name !~ /^file(\d+)$/;
+    fail "$name exists but file" . ($cnt) . " does not\n" if $1 >= $cnt;
+    fail "$name should be empty\n" if $actual{$name}[2] != 0;
+}
+pass;
@@ -0,0 +1,31 @@
+/* Creates a series of files while the kernel is configured, with
+   -jcrash=4, to crash right after writing the commit record of the
+   journal transaction that covers this test's fourth file system
+   operation, the creation of "file3", before copying it home.
+   The count starts when the test starts, so extracting the test
+   programs does not move the crash, and however operations are
+   grouped into transactions, the crash comes after file0 through
+   file3 are committed.  The persistence check verifies that
+   replaying the journal at the next boot recovers a consistent
+   prefix of the files. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 24
+
+void
+test_main (void) 
+{
+  int i;
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "file%d", i);
+      CHECK (create (name, 0), "create \"%s\"", name);
+    }
+  msg ("kernel did not crash");
+}
@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my (@output) = read_text_file ("$test.output");
+fail "kernel did not simulate a crash\n"
+  if !grep (/journal: simulated crash/, @output);
+pass;
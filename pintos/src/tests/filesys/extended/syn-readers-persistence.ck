@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+check_archive ({"child-syn-readers" => "tests/filesys/extended/child-syn-readers",
+		"readfile" => [random_bytes (32 * 512)]});
+pass;
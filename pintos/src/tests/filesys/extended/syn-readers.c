@@ -0,0 +1,30 @@
+/* Writes a file, then has many subprocesses read it at the same
+   time.  Readers of one file do not exclude each other, so they
+   all make progress in parallel. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/filesys/extended/syn-readers.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+char buf[BUF_SIZE];
+
+#define CHILD_CNT 8
+
+void
+test_main (void) 
+{
+  pid_t children[CHILD_CNT];
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  random_bytes (buf, sizeof buf);
+  CHECK (write (fd, buf, sizeof buf) == (int) sizeof buf,
+         "write %zu bytes to \"%s\"", sizeof buf, file_name);
+  close (fd);
+
+  exec_children ("child-syn-readers", children, CHILD_CNT);
+  wait_children (children, CHILD_CNT);
+}
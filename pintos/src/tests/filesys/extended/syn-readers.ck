@@ -0,0 +1,41 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(syn-readers) begin
+(syn-readers) create "readfile"
+(syn-readers) open "readfile"
+(syn-readers) write 16384 bytes to "readfile"
+(syn-readers) exec child 1 of 8: "child-syn-readers 0"
+(syn-readers) exec child 2 of 8: "child-syn-readers 1"
+(syn-readers) exec child 3 of 8: "child-syn-readers 2"
+(syn-readers) exec child 4 of 8: "child-syn-readers 3"
+(syn-readers) exec child 5 of 8: "child-syn-readers 4"
+(syn-readers) exec child 6 of 8: "child-syn-readers 5"
+(syn-readers) exec child 7 of 8: "child-syn-readers 6"
+(syn-readers) exec child 8 of 8: "child-syn-readers 7"
+(syn-readers) wait for child 1 of 8 returned 0 (expected 0)
+(syn-readers) wait for child 2 of 8 returned 1 (expected 1)
+(syn-readers) wait for child 3 of 8 returned 2 (expected 2)
+(syn-readers) wait for child 4 of 8 returned 3 (expected 3)
+(syn-readers) wait for child 5 of 8 returned 4 (expected 4)
+(syn-readers) wait for child 6 of 8 returned 5 (expected 5)
+(syn-readers) wait for child 7 of 8 returned 6 (expected 6)
+(syn-readers) wait for child 8 of 8 returned 7 (expected 7)
+(syn-readers) end
+EOF
+
+# Readers share an inode's lock, so with 8 children reading the
+# same file, some of them should hold it at the same time.  If
+# reads were serialized, no inode would ever have more than 1.
+my ($stats) = grep (/^Inode: .* readers at once/,
+		    read_text_file ("$test.output"));
+fail "No inode statistics.\n" if !defined $stats;
+my ($peak) = $stats =~ /at most (\d+) readers at once/
+  or fail "Can't parse inode statistics: $stats\n";
+fail "At most $peak reader held an inode at once; readers never overlapped.\n"
+  if $peak < 2;
+pass;
@@ -0,0 +1,9 @@
+#ifndef TESTS_FILESYS_EXTENDED_SYN_READERS_H
+#define TESTS_FILESYS_EXTENDED_SYN_READERS_H
+
+#define CHUNK_SIZE 512
+#define BUF_SIZE (32 * 512)
+#define READ_CNT 8
+static const char file_name[] = "readfile";
+
+#endif /* tests/filesys/extended/syn-readers.h */
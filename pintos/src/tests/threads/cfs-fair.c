@@ -0,0 +1,100 @@
+/* Checks that the fair scheduler divides the CPU among busy
+   threads in proportion to the weights of their priorities.
+
+   Three threads at priorities PRI_DEFAULT, PRI_DEFAULT + 3 and
+   PRI_DEFAULT + 6 weigh 1024, 2000 and 3906, so over 4 seconds
+   they should get about 14.8%, 28.9% and 56.4% of the ticks.
+   Each share must be within 20% of that. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 3
+#define TEST_TICKS 400
+
+struct spinner
+  {
+    int priority;               /* Priority to run at. */
+    int weight;                 /* Expected weight. */
+    int64_t ticks;              /* Ticks received. */
+  };
+
+static struct spinner spinners[THREAD_CNT] =
+  {
+    {PRI_DEFAULT, 1024, 0},
+    {PRI_DEFAULT + 3, 2000, 0},
+    {PRI_DEFAULT + 6, 3906, 0},
+  };
+
+static struct semaphore done;
+static volatile bool go, stop;
+
+static thread_func spin_thread;
+
+void
+test_cfs_fair (void) 
+{
+  int64_t total_ticks = 0;
+  int total_weight = 0;
+  int i;
+
+  ASSERT (thread_cfs);
+
+  sema_init (&done, 0);
+  go = stop = false;
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "spin %d", i);
+      thread_create (name, spinners[i].priority, spin_thread, &spinners[i]);
+    }
+
+  go = true;
+  timer_sleep (TEST_TICKS);
+  stop = true;
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&done);
+
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      total_ticks += spinners[i].ticks;
+      total_weight += spinners[i].weight;
+    }
+  if (total_ticks == 0)
+    fail ("spinning threads did not run");
+
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      struct spinner *s = &spinners[i];
+      int expected = s->weight * 1000 / total_weight;
+      int actual = s->ticks * 1000 / total_ticks;
+
+      if (actual < expected - expected / 5 || actual > expected + expected / 5)
+        fail ("thread %d (priority %d) got %d.%d%% of the CPU, "
+              "expected %d.%d%%", i, s->priority,
+              actual / 10, actual % 10, expected / 10, expected % 10);
+      msg ("thread %d (priority %d) got its share", i, s->priority);
+    }
+}
+
+/* Spins from GO until STOP, counting the ticks it gets. */
+static void
+spin_thread (void *spinner_) 
+{
+  struct spinner *s = spinner_;
+  struct rusage start, end;
+
+  while (!go)
+    continue;
+  thread_get_rusage (&start);
+  while (!stop)
+    continue;
+  thread_get_rusage (&end);
+
+  s->ticks = end.kernel_ticks - start.kernel_ticks;
+  sema_up (&done);
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(cfs-fair) begin
+(cfs-fair) thread 0 (priority 31) got its share
+(cfs-fair) thread 1 (priority 34) got its share
+(cfs-fair) thread 2 (priority 37) got its share
+(cfs-fair) end
+EOF
+pass;
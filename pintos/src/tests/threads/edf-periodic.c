@@ -0,0 +1,122 @@
+/* Runs several periodic EDF threads next to a busy PRI_MAX
+   thread and reports their deadline misses.  The well-behaved
+   threads must meet every deadline; one thread needs more than
+   its declared runtime, so it is throttled and misses every
+   deadline without disturbing the others.  Also checks that
+   admission control rejects invalid and overcommitted
+   reservations. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define TASK_CNT 4
+#define JOB_CNT 5
+
+struct task
+  {
+    int id;
+    int64_t runtime;            /* Declared runtime per job. */
+    int64_t period;             /* Period and deadline. */
+    uint64_t work;              /* Ticks actually used per job. */
+    int misses;                 /* Jobs that missed their deadline. */
+  };
+
+/* The first three use 60% of the CPU and leave themselves a
+   tick of slack; the last overruns its 10% reservation. */
+static struct task tasks[TASK_CNT] =
+  {
+    {0, 2, 10, 1, 0},
+    {1, 3, 15, 2, 0},
+    {2, 4, 20, 3, 0},
+    {3, 2, 20, 5, 0},
+  };
+
+static struct semaphore admitted;
+static struct semaphore done;
+static volatile int finished;
+
+static thread_func periodic_thread;
+static thread_func hog_thread;
+
+void
+test_edf_periodic (void) 
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&admitted, 0);
+  sema_init (&done, 0);
+  finished = 0;
+
+  for (i = 0; i < TASK_CNT; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "edf %d", i);
+      thread_create (name, PRI_DEFAULT, periodic_thread, &tasks[i]);
+    }
+  for (i = 0; i < TASK_CNT; i++)
+    sema_down (&admitted);
+  msg ("%d periodic threads admitted", TASK_CNT);
+
+  if (thread_set_edf (3, 10, 2))
+    fail ("admitted runtime longer than deadline");
+  if (thread_set_edf (3, 5, 10))
+    fail ("admitted deadline longer than period");
+  if (thread_set_edf (3, 10, 10))
+    fail ("admitted overcommitted reservation");
+  msg ("invalid and overcommitted reservations rejected");
+
+  thread_create ("hog", PRI_MAX, hog_thread, NULL);
+  for (i = 0; i < TASK_CNT; i++)
+    sema_down (&done);
+
+  for (i = 0; i < TASK_CNT; i++)
+    msg ("thread %d: %d jobs, %d deadline misses",
+         i, JOB_CNT, tasks[i].misses);
+}
+
+/* Runs JOB_CNT jobs of TASK_'s declared shape. */
+static void
+periodic_thread (void *task_) 
+{
+  struct task *task = task_;
+  int i;
+
+  if (!thread_set_edf (task->runtime, task->period, task->period))
+    fail ("thread %d not admitted", task->id);
+  sema_up (&admitted);
+
+  for (i = 0; i < JOB_CNT; i++)
+    {
+      struct rusage usage;
+      uint64_t start;
+
+      thread_get_rusage (&usage);
+      start = usage.kernel_ticks;
+      do
+        thread_get_rusage (&usage);
+      while (usage.kernel_ticks - start < task->work);
+
+      if (!thread_edf_yield ())
+        task->misses++;
+    }
+
+  /* Stay in the EDF class, which outranks the hog, until the
+     end; exiting gives back the reservation. */
+  finished++;
+  sema_up (&done);
+}
+
+/* Keeps the CPU busy at the highest priority until every
+   periodic thread is finished. */
+static void
+hog_thread (void *aux UNUSED) 
+{
+  while (finished < TASK_CNT)
+    continue;
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-periodic) begin
+(edf-periodic) 4 periodic threads admitted
+(edf-periodic) invalid and overcommitted reservations rejected
+(edf-periodic) thread 0: 5 jobs, 0 deadline misses
+(edf-periodic) thread 1: 5 jobs, 0 deadline misses
+(edf-periodic) thread 2: 5 jobs, 0 deadline misses
+(edf-periodic) thread 3: 5 jobs, 5 deadline misses
+(edf-periodic) end
+EOF
+pass;
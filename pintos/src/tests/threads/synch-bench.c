@@ -0,0 +1,124 @@
+/* Measures the uncontended cost of acquiring and releasing each
+   kind of lock in threads/synch.c, in CPU cycles per pair, and
+   checks that the spinning primitives disable interrupts while
+   held and restore them on release.
+
+   The cycle counts depend on the machine and simulator, so only
+   their relations are checked: each spinning primitive, which
+   only disables interrupts and does an atomic operation, must
+   be cheaper than a lock, which also manipulates a semaphore and
+   the priority donation state. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+
+/* Number of acquire/release pairs timed for each primitive. */
+#define ITERS 10000
+
+static void report (const char *name, uint64_t start);
+
+void
+test_synch_bench (void) 
+{
+  struct lock lock;
+  struct spinlock spinlock;
+  struct ticketlock ticketlock;
+  struct seqlock seqlock;
+  enum intr_level old_level;
+  volatile int data = 0;
+  uint64_t start;
+  unsigned seq;
+  int copy = 0;
+  int i;
+
+  lock_init (&lock);
+  spinlock_init (&spinlock);
+  ticketlock_init (&ticketlock);
+  seqlock_init (&seqlock);
+
+  /* Sanity checks. */
+  old_level = spinlock_acquire (&spinlock);
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (spinlock_held_by_current_thread (&spinlock));
+  spinlock_release (&spinlock, old_level);
+  ASSERT (intr_get_level () == INTR_ON);
+  ASSERT (!spinlock_held_by_current_thread (&spinlock));
+
+  old_level = ticketlock_acquire (&ticketlock);
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (ticketlock_held_by_current_thread (&ticketlock));
+  ticketlock_release (&ticketlock, old_level);
+  ASSERT (intr_get_level () == INTR_ON);
+  ASSERT (!ticketlock_held_by_current_thread (&ticketlock));
+
+  seq = seqlock_read_begin (&seqlock);
+  old_level = seqlock_write_begin (&seqlock);
+  data++;
+  seqlock_write_end (&seqlock, old_level);
+  ASSERT (seqlock_read_retry (&seqlock, seq));
+  seq = seqlock_read_begin (&seqlock);
+  ASSERT (!seqlock_read_retry (&seqlock, seq));
+  msg ("sanity checks passed");
+
+  /* Timings. */
+  start = rdtsc ();
+  for (i = 0; i < ITERS; i++)
+    {
+      lock_acquire (&lock);
+      data++;
+      lock_release (&lock);
+    }
+  report ("lock", start);
+
+  start = rdtsc ();
+  for (i = 0; i < ITERS; i++)
+    {
+      old_level = spinlock_acquire (&spinlock);
+      data++;
+      spinlock_release (&spinlock, old_level);
+    }
+  report ("spinlock", start);
+
+  start = rdtsc ();
+  for (i = 0; i < ITERS; i++)
+    {
+      old_level = ticketlock_acquire (&ticketlock);
+      data++;
+      ticketlock_release (&ticketlock, old_level);
+    }
+  report ("ticketlock", start);
+
+  start = rdtsc ();
+  for (i = 0; i < ITERS; i++)
+    {
+      do
+        {
+          seq = seqlock_read_begin (&seqlock);
+          copy = data;
+        }
+      while (seqlock_read_retry (&seqlock, seq));
+    }
+  report ("seqlock read", start);
+  ASSERT (copy == data);
+
+  start = rdtsc ();
+  for (i = 0; i < ITERS; i++)
+    {
+      old_level = seqlock_write_begin (&seqlock);
+      data++;
+      seqlock_write_end (&seqlock, old_level);
+    }
+  report ("seqlock write", start);
+}
+
+/* Reports the average cycles per iteration since START. */
+static void
+report (const char *name, uint64_t start)
+{
+  uint64_t cycles = rdtsc () - start;
+  msg ("%s: %"PRIu64" cycles per iteration", name, cycles / ITERS);
+}
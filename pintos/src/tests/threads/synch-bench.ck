@@ -0,0 +1,30 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+fail "Sanity checks did not pass.\n"
+  if !grep (/\(synch-bench\) sanity checks passed$/, @output);
+
+my (%cycles);
+foreach my $name ('lock', 'spinlock', 'ticketlock',
+		  'seqlock read', 'seqlock write') {
+    my ($line) = grep (/\(synch-bench\) $name: \d+ cycles per iteration$/,
+		       @output);
+    fail "No timing reported for $name.\n" if !defined $line;
+    ($cycles{$name}) = $line =~ /: (\d+) cycles/;
+}
+
+# The absolute timings vary from machine to machine, but the
+# spinning primitives do strictly less work than a lock.
+foreach my $name ('spinlock', 'ticketlock', 'seqlock read') {
+    fail "$name took $cycles{$name} cycles per iteration, "
+      . "not less than lock's $cycles{lock}.\n"
+      if $cycles{$name} >= $cycles{lock};
+}
+pass;
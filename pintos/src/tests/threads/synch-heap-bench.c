@@ -0,0 +1,182 @@
+/* Queues threads of mixed priorities on a semaphore, then on a
+   condition variable, and wakes them one at a time.  Checks that
+   they wake in order of decreasing priority, first come first
+   served among equal priorities, and reports the average cost in
+   CPU cycles of each sema_up() and cond_signal().
+
+   Each primitive is measured with a short queue and with a queue
+   16 times as long.  The cycle counts depend on the machine and
+   simulator, but with waiters kept in a heap the cost of a
+   wakeup grows with the logarithm of the queue length, so the
+   check fails if the long queue's cost grows anywhere near
+   linearly. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/cpu.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Queue lengths measured. */
+#define SHORT_CNT 16
+#define WAITER_CNT 256
+
+/* A waiting thread. */
+struct waiter
+  {
+    int priority;               /* Its priority. */
+    int id;                     /* Order in which it started waiting. */
+  };
+
+static struct waiter waiters[WAITER_CNT];
+static struct waiter *woken[WAITER_CNT];
+static int woken_cnt;
+
+static struct semaphore sema;
+static struct lock lock;
+static struct condition cond;
+
+static thread_func sema_waiter, cond_waiter;
+static void bench_sema (int cnt);
+static void bench_cond (int cnt);
+static void create_waiters (thread_func *, int cnt);
+static void check_order (const char *what, int cnt);
+
+void
+test_synch_heap_bench (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Every waiter has higher priority than we do, so each one runs
+     until it blocks as soon as it is created, and runs again as
+     soon as it is woken and we yield. */
+  thread_set_priority (PRI_MIN);
+
+  sema_init (&sema, 0);
+  lock_init (&lock);
+  cond_init (&cond);
+
+  bench_sema (SHORT_CNT);
+  bench_sema (WAITER_CNT);
+  bench_cond (SHORT_CNT);
+  bench_cond (WAITER_CNT);
+}
+
+/* Queues CNT waiters on the semaphore and times waking them. */
+static void
+bench_sema (int cnt) 
+{
+  enum intr_level old_level;
+  uint64_t cycles = 0;
+  int i;
+
+  create_waiters (sema_waiter, cnt);
+  for (i = 0; i < cnt; i++)
+    {
+      uint64_t start;
+
+      old_level = intr_disable ();
+      start = rdtsc ();
+      sema_up (&sema);
+      cycles += rdtsc () - start;
+      intr_set_level (old_level);
+      thread_yield ();
+    }
+  check_order ("sema_up", cnt);
+  msg ("sema_up: %"PRIu64" cycles per wakeup of %d waiters",
+       cycles / cnt, cnt);
+}
+
+/* Queues CNT waiters on the condition variable and times waking
+   them. */
+static void
+bench_cond (int cnt) 
+{
+  enum intr_level old_level;
+  uint64_t cycles = 0;
+  int i;
+
+  create_waiters (cond_waiter, cnt);
+  for (i = 0; i < cnt; i++)
+    {
+      uint64_t start;
+
+      lock_acquire (&lock);
+      old_level = intr_disable ();
+      start = rdtsc ();
+      cond_signal (&cond, &lock);
+      cycles += rdtsc () - start;
+      intr_set_level (old_level);
+      lock_release (&lock);
+      thread_yield ();
+    }
+  check_order ("cond_signal", cnt);
+  msg ("cond_signal: %"PRIu64" cycles per wakeup of %d waiters",
+       cycles / cnt, cnt);
+}
+
+/* Creates CNT threads running FUNC, with priorities spread over
+   PRI_MIN + 1...PRI_MAX so that many share one. */
+static void
+create_waiters (thread_func *func, int cnt) 
+{
+  int i;
+
+  woken_cnt = 0;
+  for (i = 0; i < cnt; i++)
+    {
+      struct waiter *w = &waiters[i];
+      char name[16];
+
+      w->priority = PRI_MIN + 1 + (i * 7) % (PRI_MAX - PRI_MIN);
+      w->id = i;
+      snprintf (name, sizeof name, "waiter %d", i);
+      thread_create (name, w->priority, func, w);
+    }
+}
+
+/* Fails unless all CNT waiters woke, in order of decreasing
+   priority and then increasing id. */
+static void
+check_order (const char *what, int cnt) 
+{
+  int i;
+
+  if (woken_cnt != cnt)
+    fail ("%s: %d of %d waiters woke", what, woken_cnt, cnt);
+  for (i = 1; i < cnt; i++)
+    {
+      const struct waiter *a = woken[i - 1];
+      const struct waiter *b = woken[i];
+      if (a->priority < b->priority
+          || (a->priority == b->priority && a->id > b->id))
+        fail ("%s: waiter %d (priority %d) woke before "
+              "waiter %d (priority %d)",
+              what, a->id, a->priority, b->id, b->priority);
+    }
+  msg ("%s: %d waiters woke in priority order", what, cnt);
+}
+
+static void
+sema_waiter (void *w_) 
+{
+  struct waiter *w = w_;
+
+  sema_down (&sema);
+  woken[woken_cnt++] = w;
+}
+
+static void
+cond_waiter (void *w_) 
+{
+  struct waiter *w = w_;
+
+  lock_acquire (&lock);
+  cond_wait (&cond, &lock);
+  woken[woken_cnt++] = w;
+  lock_release (&lock);
+}
@@ -0,0 +1,31 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+# The absolute timings vary from machine to machine.  The long
+# queue is 16 times the short one, so a wakeup that scans the
+# waiters would cost about 16 times as much, but taking the top of
+# a heap costs only about twice as much.
+foreach my $name ('sema_up', 'cond_signal') {
+    my (%cycles);
+    foreach my $cnt (16, 256) {
+	fail "$cnt waiters did not wake in priority order for $name.\n"
+	  if !grep (/\(synch-heap-bench\) $name: $cnt waiters woke in priority order$/,
+		    @output);
+	my ($line) = grep (/\(synch-heap-bench\) $name: \d+ cycles per wakeup of $cnt waiters$/,
+			   @output);
+	fail "No timing reported for $name with $cnt waiters.\n"
+	  if !defined $line;
+	($cycles{$cnt}) = $line =~ /: (\d+) cycles/;
+    }
+    fail "$name took $cycles{256} cycles per wakeup of 256 waiters, "
+      . "more than 4 times the $cycles{16} for 16 waiters.\n"
+      if $cycles{256} > 4 * $cycles{16};
+}
+pass;
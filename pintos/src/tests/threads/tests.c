@@ -38,6 +38,12 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"synch-bench", test_synch_bench},
+    {"synch-heap-bench", test_synch_heap_bench},
+    {"workqueue", test_workqueue},
+    {"thread-create-bench", test_thread_create_bench},
+    {"edf-periodic", test_edf_periodic},
+    {"cfs-fair", test_cfs_fair},
   };
 
 static const char *test_name;
@@ -32,6 +32,12 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_synch_bench;
+extern test_func test_synch_heap_bench;
+extern test_func test_workqueue;
+extern test_func test_thread_create_bench;
+extern test_func test_edf_periodic;
+extern test_func test_cfs_fair;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
@@ -0,0 +1,53 @@
+/* Creates 10,000 short-lived threads, one after another, and
+   reports the average cost of creating and exiting one, in CPU
+   cycles.  Checks that every thread ran.
+
+   The cycle count depends on the machine and simulator, so it is
+   reported but not checked.  Instead, the check looks at the
+   thread page statistics printed at power off: since each child
+   exits before the next is created, nearly every child should
+   get the page of one that exited before it. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/cpu.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+
+#define THREAD_CNT 10000
+
+static int ran_cnt;
+
+static thread_func run_once;
+
+void
+test_thread_create_bench (void) 
+{
+  uint64_t start, cycles;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* The children have higher priority than we do, so each one
+     runs and exits as soon as it is created. */
+  thread_set_priority (PRI_DEFAULT - 1);
+  start = rdtsc ();
+  for (i = 0; i < THREAD_CNT; i++)
+    if (thread_create ("child", PRI_DEFAULT, run_once, NULL) == TID_ERROR)
+      fail ("thread_create() failed after %d threads", i);
+  cycles = rdtsc () - start;
+
+  if (ran_cnt != THREAD_CNT)
+    fail ("%d of %d threads ran", ran_cnt, THREAD_CNT);
+  msg ("%d threads ran", THREAD_CNT);
+  msg ("%"PRIu64" cycles per thread created and exited",
+       cycles / THREAD_CNT);
+}
+
+static void
+run_once (void *aux UNUSED) 
+{
+  ran_cnt++;
+}
@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+fail "Not every thread ran.\n"
+  if !grep (/\(thread-create-bench\) 10000 threads ran$/, @output);
+fail "No timing reported.\n"
+  if !grep (/\(thread-create-bench\) \d+ cycles per thread created and exited$/,
+	    @output);
+
+# Each child exits before the next one is created, so nearly all of
+# them should reuse a cached page instead of allocating one.
+my ($stats) = grep (/^Thread pages: \d+ reused, \d+ allocated$/, @output);
+fail "Thread page statistics missing.\n" if !defined $stats;
+my ($reused, $allocated) = $stats =~ /(\d+) reused, (\d+) allocated/;
+fail "Only $reused of 10000 thread pages were reused "
+  . "($allocated allocated).\n"
+  if $reused < 9000;
+pass;
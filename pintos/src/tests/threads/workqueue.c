@@ -0,0 +1,72 @@
+/* Checks that queued work items run, that an item cannot be
+   queued twice while it is pending, and that delayed items wait
+   at least as long as requested. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "devices/timer.h"
+#include "threads/synch.h"
+#include "threads/workqueue.h"
+
+#define ITEM_CNT 4
+
+static struct work items[ITEM_CNT];
+static int64_t ran_at[ITEM_CNT];
+static struct semaphore done;
+
+static work_func record;
+
+void
+test_workqueue (void) 
+{
+  int64_t start;
+  int i;
+
+  sema_init (&done, 0);
+  for (i = 0; i < ITEM_CNT; i++)
+    work_init (&items[i], record, (void *) i);
+
+  /* Immediate work. */
+  for (i = 0; i < ITEM_CNT; i++)
+    {
+      ran_at[i] = -1;
+      if (!work_queue (&items[i]))
+        fail ("could not queue item %d", i);
+    }
+  for (i = 0; i < ITEM_CNT; i++)
+    sema_down (&done);
+  for (i = 0; i < ITEM_CNT; i++)
+    if (ran_at[i] >= 0)
+      msg ("item %d ran", i);
+
+  /* An item that is still pending cannot be queued again. */
+  if (!work_queue_delayed (&items[0], 5))
+    fail ("could not delay item 0");
+  if (work_queue (&items[0]))
+    fail ("queued item 0 twice");
+  sema_down (&done);
+  msg ("pending item was not queued twice");
+
+  /* Delayed work, queued latest first. */
+  start = timer_ticks ();
+  for (i = ITEM_CNT - 1; i >= 0; i--)
+    if (!work_queue_delayed (&items[i], 10 * (i + 1)))
+      fail ("could not delay item %d", i);
+  for (i = 0; i < ITEM_CNT; i++)
+    sema_down (&done);
+  for (i = 0; i < ITEM_CNT; i++)
+    {
+      if (ran_at[i] - start < 10 * (i + 1))
+        fail ("item %d ran after %d ticks, expected at least %d",
+              i, (int) (ran_at[i] - start), 10 * (i + 1));
+      msg ("delayed item %d ran on time", i);
+    }
+}
+
+/* Records when the item with id AUX ran. */
+static void
+record (void *aux) 
+{
+  ran_at[(int) aux] = timer_ticks ();
+  sema_up (&done);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue) begin
+(workqueue) item 0 ran
+(workqueue) item 1 ran
+(workqueue) item 2 ran
+(workqueue) item 3 ran
+(workqueue) pending item was not queued twice
+(workqueue) delayed item 0 ran on time
+(workqueue) delayed item 1 ran on time
+(workqueue) delayed item 2 ran on time
+(workqueue) delayed item 3 ran on time
+(workqueue) end
+EOF
+pass;
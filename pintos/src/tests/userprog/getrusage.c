@@ -0,0 +1,39 @@
+/* Checks that getrusage() charges user time to a process
+   spinning in user mode, and blocked time and a voluntary
+   context switch to a process waiting for a child. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct rusage before, after;
+  volatile unsigned spin;
+  int i;
+
+  getrusage (&before);
+
+  msg ("spin in user mode");
+  for (i = 0; i < 1000; i++)
+    {
+      for (spin = 0; spin < 100000; spin++)
+        continue;
+      getrusage (&after);
+      if (after.user_ticks > before.user_ticks)
+        break;
+    }
+  CHECK (after.user_ticks > before.user_ticks,
+         "user ticks charged while spinning");
+
+  before = after;
+  wait (exec ("child-simple"));
+  getrusage (&after);
+  CHECK (after.voluntary_switches > before.voluntary_switches,
+         "voluntary switch charged while waiting");
+  CHECK (after.blocked_cycles > before.blocked_cycles,
+         "blocked time charged while waiting");
+  CHECK (after.runq_max_cycles <= after.runq_cycles,
+         "longest run-queue wait within total");
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(getrusage) begin
+(getrusage) spin in user mode
+(getrusage) user ticks charged while spinning
+(child-simple) run
+child-simple: exit(81)
+(getrusage) voluntary switch charged while waiting
+(getrusage) blocked time charged while waiting
+(getrusage) longest run-queue wait within total
+(getrusage) end
+getrusage: exit(0)
+EOF
+pass;
@@ -18,10 +18,13 @@
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
+#include "threads/lockstat.h"
+#include "threads/trace.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -34,8 +37,11 @@
 #ifdef FILESYS
 #include "devices/block.h"
 #include "devices/ide.h"
+#include "devices/raid0.h"
+#include "devices/ramdisk.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
+#include "filesys/journal.h"
 #endif
 
 /* Page directory with kernel mappings only. */
@@ -52,11 +58,24 @@ static const char *scratch_bdev_name;
 #ifdef VM
 static const char *swap_bdev_name;
 #endif
+
+/* -raid0, -stripe: Block devices to stripe into "md0" and the
+   stripe unit in sectors. */
+static const char *raid0_bdev_names;
+static unsigned raid0_stripe = RAID0_DEFAULT_STRIPE;
+
+/* -ramdisk: Sizes and types of RAM disks to create. */
+#define RAMDISK_MAX 4
+static char *ramdisk_specs[RAMDISK_MAX];
+static size_t ramdisk_spec_cnt;
 #endif /* FILESYS */
 
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
+/* -trace: Record scheduler events? */
+static bool trace_requested;
+
 static void bss_init (void);
 static void paging_init (void);
 
@@ -66,6 +85,7 @@ static void run_actions (char **argv);
 static void usage (void);
 
 #ifdef FILESYS
+static void create_ramdisks (void);
 static void locate_block_devices (void);
 static void locate_block_device (enum block_type, const char *name);
 #endif
@@ -89,6 +109,7 @@ main (void)
      then enable console locking. */
   thread_init ();
   console_init ();  
+  workqueue_init ();
 
   /* Greet user. */
   printf ("Pintos booting with %'"PRIu32" kB RAM...\n",
@@ -117,12 +138,18 @@ main (void)
 
   /* Start thread scheduler and enable interrupts. */
   thread_start ();
+  workqueue_start ();
   serial_init_queue ();
   timer_calibrate ();
+  if (trace_requested)
+    trace_init ();
 
 #ifdef FILESYS
   /* Initialize file system. */
+  create_ramdisks ();
   ide_init ();
+  if (raid0_bdev_names != NULL)
+    raid0_init (raid0_bdev_names, raid0_stripe);
   locate_block_devices ();
   filesys_init (format_filesys);
 #endif
@@ -247,6 +274,22 @@ parse_options (char **argv)
         filesys_bdev_name = value;
       else if (!strcmp (name, "-scratch"))
         scratch_bdev_name = value;
+      else if (!strcmp (name, "-jcrash"))
+        journal_crash_after = atoi (value);
+      else if (!strcmp (name, "-nodma"))
+        ide_dma_disabled = true;
+      else if (!strcmp (name, "-raid0"))
+        raid0_bdev_names = value;
+      else if (!strcmp (name, "-stripe"))
+        raid0_stripe = atoi (value);
+      else if (!strcmp (name, "-ramdisk"))
+        {
+          if (value == NULL)
+            PANIC ("-ramdisk requires a size");
+          if (ramdisk_spec_cnt >= RAMDISK_MAX)
+            PANIC ("too many -ramdisk options (max %d)", RAMDISK_MAX);
+          ramdisk_specs[ramdisk_spec_cnt++] = value;
+        }
 #ifdef VM
       else if (!strcmp (name, "-swap"))
         swap_bdev_name = value;
@@ -256,6 +299,12 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-cfs"))
+        thread_cfs = true;
+      else if (!strcmp (name, "-lockstat"))
+        lockstat_enabled = true;
+      else if (!strcmp (name, "-trace"))
+        trace_requested = true;
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -284,6 +333,9 @@ run_task (char **argv)
   const char *task = argv[1];
   
   printf ("Executing '%s':\n", task);
+#ifdef FILESYS
+  journal_arm_crash ();
+#endif
 #ifdef USERPROG
   process_wait (process_execute (task));
 #else
@@ -292,6 +344,13 @@ run_task (char **argv)
   printf ("Execution of '%s' complete.\n", task);
 }
 
+/* Prints lock statistics. */
+static void
+print_lockstat (char **argv UNUSED)
+{
+  lockstat_print_stats ();
+}
+
 /* Executes all of the actions specified in ARGV[]
    up to the null pointer sentinel. */
 static void
@@ -309,12 +368,15 @@ run_actions (char **argv)
   static const struct action actions[] = 
     {
       {"run", 2, run_task},
+      {"lockstat", 1, print_lockstat},
 #ifdef FILESYS
       {"ls", 1, fsutil_ls},
       {"cat", 2, fsutil_cat},
       {"rm", 2, fsutil_rm},
       {"extract", 1, fsutil_extract},
       {"append", 2, fsutil_append},
+      {"bench", 2, fsutil_bench},
+      {"iostat", 1, fsutil_iostat},
 #endif
       {NULL, 0, NULL},
     };
@@ -357,6 +419,7 @@ usage (void)
 #else
           "  run TEST           Run TEST.\n"
 #endif
+          "  lockstat           Print lock statistics (see -lockstat).\n"
 #ifdef FILESYS
           "  ls                 List files in the root directory.\n"
           "  cat FILE           Print FILE to the console.\n"
@@ -364,6 +427,8 @@ usage (void)
           "Use these actions indirectly via `pintos' -g and -p options:\n"
           "  extract            Untar from scratch device into file system.\n"
           "  append FILE        Append FILE to tar file on scratch device.\n"
+          "  bench BDEV         Time sequential reads of block device BDEV.\n"
+          "  iostat             Print I/O statistics for each block device.\n"
 #endif
           "\nOptions:\n"
           "  -h                 Print this help message and power off.\n"
@@ -373,12 +438,22 @@ usage (void)
           "  -f                 Format file system device during startup.\n"
           "  -filesys=BDEV      Use BDEV for file system instead of default.\n"
           "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
+          "  -jcrash=N          Crash after committing the Nth file system\n"
+          "                     operation of the 'run' action.\n"
+          "  -nodma             Transfer IDE disk data by PIO, not DMA.\n"
+          "  -raid0=BDEV,...    Stripe BDEVs into block device md0.\n"
+          "  -stripe=SECTORS    Set md0's stripe unit (default: 16).\n"
+          "  -ramdisk=KB[,TYPE] Create a KB-kB RAM disk of TYPE (default: raw),\n"
+          "                     e.g. filesys, scratch or swap.  May repeat.\n"
 #ifdef VM
           "  -swap=BDEV         Use BDEV for swap instead of default.\n"
 #endif
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -cfs               Use fair scheduler weighted by priority.\n"
+          "  -lockstat          Collect contention statistics for named locks.\n"
+          "  -trace             Trace scheduler events, printed at shutdown.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -387,6 +462,36 @@ usage (void)
 }
 
 #ifdef FILESYS
+/* Creates the RAM disks requested with -ramdisk, before the IDE
+   disks are probed, so that a RAM disk whose type names a role
+   is used for that role by default. */
+static void
+create_ramdisks (void)
+{
+  size_t i;
+
+  for (i = 0; i < ramdisk_spec_cnt; i++)
+    {
+      char *save_ptr;
+      char *size = strtok_r (ramdisk_specs[i], ",", &save_ptr);
+      char *type_name = strtok_r (NULL, "", &save_ptr);
+      enum block_type type = BLOCK_RAW;
+      int kb = size != NULL ? atoi (size) : 0;
+
+      if (kb <= 0)
+        PANIC ("-ramdisk: bad size");
+      if (type_name != NULL)
+        {
+          for (type = 0; type < BLOCK_CNT; type++)
+            if (!strcmp (type_name, block_type_name (type)))
+              break;
+          if (type == BLOCK_CNT)
+            PANIC ("-ramdisk: unknown type \"%s\"", type_name);
+        }
+      ramdisk_create (type, kb * 1024 / BLOCK_SECTOR_SIZE);
+    }
+}
+
 /* Figure out what block devices to cast in the various Pintos roles. */
 static void
 locate_block_devices (void)
@@ -0,0 +1,132 @@
+#include "threads/lockstat.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+
+/* Lock contention statistics.
+
+   A lock, semaphore or spinlock given a name with lock_set_name()
+   and friends, while statistics are enabled, gets a struct
+   lockstat from the registry below.  The synchronization
+   primitives then time each acquisition that has one.  Unnamed
+   primitives, and all of them when statistics are disabled, pay
+   only a null pointer test.
+
+   The registry is a fixed array rather than a malloc()'d list,
+   because malloc()'s own locks are among those registered. */
+
+/* Maximum number of registered locks. */
+#define LOCKSTAT_MAX 64
+
+/* Registry. */
+static struct lockstat lockstats[LOCKSTAT_MAX];
+static size_t lockstat_cnt;
+
+/* Collect statistics? */
+bool lockstat_enabled;
+
+static int compare_wait (const void *, const void *);
+
+/* Returns a new statistics record for a lock named NAME, or a
+   null pointer if statistics are disabled or the registry is
+   full. */
+struct lockstat *
+lockstat_register (const char *name)
+{
+  struct lockstat *ls = NULL;
+  enum intr_level old_level;
+
+  ASSERT (name != NULL);
+
+  if (!lockstat_enabled)
+    return NULL;
+
+  old_level = intr_disable ();
+  if (lockstat_cnt < LOCKSTAT_MAX)
+    {
+      ls = &lockstats[lockstat_cnt++];
+      memset (ls, 0, sizeof *ls);
+      strlcpy (ls->name, name, sizeof ls->name);
+    }
+  intr_set_level (old_level);
+  return ls;
+}
+
+/* Records an acquisition of the lock that LS describes, which
+   started at cycle START and had to wait if CONTENDED is true.
+   Also starts timing the hold. */
+void
+lockstat_acquired (struct lockstat *ls, uint64_t start, bool contended)
+{
+  enum intr_level old_level;
+  uint64_t now, wait;
+
+  old_level = intr_disable ();
+  now = rdtsc ();
+  wait = now - start;
+  ls->acquire_cnt++;
+  if (contended)
+    ls->contended_cnt++;
+  ls->wait_cycles += wait;
+  if (wait > ls->max_wait_cycles)
+    ls->max_wait_cycles = wait;
+  ls->hold_start = now;
+  intr_set_level (old_level);
+}
+
+/* Records the release of the lock that LS describes. */
+void
+lockstat_released (struct lockstat *ls)
+{
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  ls->hold_cycles += rdtsc () - ls->hold_start;
+  intr_set_level (old_level);
+}
+
+/* Prints the statistics of every registered lock, sorted by
+   total wait time, longest first. */
+void
+lockstat_print_stats (void)
+{
+  struct lockstat *sorted[LOCKSTAT_MAX];
+  size_t i;
+
+  if (!lockstat_enabled)
+    return;
+
+  for (i = 0; i < lockstat_cnt; i++)
+    sorted[i] = &lockstats[i];
+  qsort (sorted, lockstat_cnt, sizeof *sorted, compare_wait);
+
+  printf ("Lockstat: %zu locks, times in cycles, sorted by total wait\n",
+          lockstat_cnt);
+  printf ("  %-16s %10s %10s %14s %12s %14s\n",
+          "name", "acquires", "contended", "wait", "max wait", "hold");
+  for (i = 0; i < lockstat_cnt; i++)
+    {
+      const struct lockstat *ls = sorted[i];
+      printf ("  %-16s %10"PRIu64" %10"PRIu64" %14"PRIu64" %12"PRIu64
+              " %14"PRIu64"\n", ls->name, ls->acquire_cnt,
+              ls->contended_cnt, ls->wait_cycles, ls->max_wait_cycles,
+              ls->hold_cycles);
+    }
+}
+
+/* qsort() comparison function that orders struct lockstat
+   pointers by decreasing total wait time. */
+static int
+compare_wait (const void *a_, const void *b_)
+{
+  const struct lockstat *a = *(struct lockstat *const *) a_;
+  const struct lockstat *b = *(struct lockstat *const *) b_;
+
+  if (a->wait_cycles != b->wait_cycles)
+    return a->wait_cycles < b->wait_cycles ? 1 : -1;
+  return 0;
+}
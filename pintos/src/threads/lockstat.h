@@ -0,0 +1,29 @@
+#ifndef THREADS_LOCKSTAT_H
+#define THREADS_LOCKSTAT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Statistics for one named lock, semaphore or spinlock.
+   All times are in CPU cycles, as counted by rdtsc(). */
+struct lockstat
+  {
+    char name[24];              /* Name, for reporting. */
+    uint64_t acquire_cnt;       /* Number of acquisitions. */
+    uint64_t contended_cnt;     /* Acquisitions that had to wait. */
+    uint64_t wait_cycles;       /* Total time spent waiting. */
+    uint64_t max_wait_cycles;   /* Longest single wait. */
+    uint64_t hold_cycles;       /* Total time held. */
+    uint64_t hold_start;        /* When the current holder got it. */
+  };
+
+/* If true, named locks collect statistics.
+   Controlled by kernel command-line option "-lockstat". */
+extern bool lockstat_enabled;
+
+struct lockstat *lockstat_register (const char *name);
+void lockstat_acquired (struct lockstat *, uint64_t start, bool contended);
+void lockstat_released (struct lockstat *);
+void lockstat_print_stats (void);
+
+#endif /* threads/lockstat.h */
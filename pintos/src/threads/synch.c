@@ -29,19 +29,59 @@
 #include "threads/synch.h"
 #include <stdio.h>
 #include <string.h>
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
+#include "threads/lockstat.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 
-/* comparator function for donating waiters */
+/* Wait queues.
+
+   Semaphores and condition variables keep their waiters in
+   binary heaps ordered by the priority each waiting thread had
+   when it was last queued, so that waking the highest-priority
+   waiter takes O(log n) time instead of a scan of every waiter.
+   Waiters of equal priority are woken in the order they started
+   waiting.
+
+   A waiter's priority can rise while it waits, when a thread
+   blocks on a lock that the waiter holds and donates its
+   priority.  sema_down() then walks the chain of lock holders
+   from the new waiter and re-keys each one in the heaps that it
+   is waiting in.  A waiter's priority cannot otherwise change
+   while it waits: donations are only withdrawn by the donee
+   releasing a lock, which it cannot do while blocked.
+
+   The heaps are only modified with interrupts disabled, because
+   sema_down() may re-key a waiter in any of them. */
+
+/* Orders waiters so that a strictly later start is "less". */
+static unsigned wait_seq;
 
 static bool
-cmp_list_pri (const struct list_elem *a, const struct list_elem *b,
-	      void *aux UNUSED)
+wait_less (const struct heap_elem *a_, const struct heap_elem *b_,
+           void *aux UNUSED)
 {
-  struct thread *x = list_entry(a, struct thread, elem);
-  struct thread *y = list_entry(b, struct thread, elem);
-  if(get_pri (x) < get_pri(y)) return true;
-  else return false;
+  const struct thread *a = heap_entry (a_, struct thread, wait_elem);
+  const struct thread *b = heap_entry (b_, struct thread, wait_elem);
+
+  if (a->wait_priority != b->wait_priority)
+    return a->wait_priority < b->wait_priority;
+  return (int) (a->wait_seq - b->wait_seq) > 0;
+}
+
+/* Recomputes T's priority and re-keys it in the heaps that it is
+   waiting in.  Interrupts must be off. */
+static void
+requeue (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  t->wait_priority = get_pri (t);
+  if (t->wait_heap != NULL)
+    heap_update (t->wait_heap, &t->wait_elem);
+  if (t->cond_heap != NULL)
+    heap_update (t->cond_heap, t->cond_elem);
 }
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
@@ -59,7 +99,18 @@ sema_init (struct semaphore *sema, unsigned value)
   ASSERT (sema != NULL);
 
   sema->value = value;
-  list_init (&sema->waiters);
+  heap_init (&sema->waiters, wait_less, NULL);
+  sema->stat = NULL;
+}
+
+/* Names SEMA, so that its waits are counted and timed if lock
+   statistics are enabled.  NAME is copied. */
+void
+sema_set_name (struct semaphore *sema, const char *name)
+{
+  ASSERT (sema != NULL);
+
+  sema->stat = lockstat_register (name);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -73,17 +124,40 @@ void
 sema_down (struct semaphore *sema) 
 {
   enum intr_level old_level;
+  uint64_t start = 0;
+  bool contended;
 
   ASSERT (sema != NULL);
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
+  if (sema->stat != NULL)
+    start = rdtsc ();
+  contended = sema->value == 0;
   while (sema->value == 0) 
     {
-      list_push_back (&sema->waiters, &thread_current ()->elem);
+      struct thread *cur = thread_current ();
+      struct lock *l;
+
+      cur->wait_seq = wait_seq++;
+      cur->wait_heap = &sema->waiters;
+      heap_insert (&sema->waiters, &cur->wait_elem);
+      requeue (cur);
+
+      /* Pass our priority along the chain of lock holders. */
+      for (l = cur->waiting_lock; l != NULL && l->holder != NULL;
+           l = l->holder->waiting_lock)
+        {
+          requeue (l->holder);
+          TRACE (TRACE_DONATE, l->holder->tid, cur->tid,
+                 l->holder->wait_priority);
+        }
+
       thread_block ();
     }
   sema->value--;
+  if (sema->stat != NULL)
+    lockstat_acquired (sema->stat, start, contended);
   intr_set_level (old_level);
 }
 
@@ -125,11 +199,11 @@ sema_up (struct semaphore *sema)
   ASSERT (sema != NULL);
 
   old_level = intr_disable ();
-  if (!list_empty (&sema->waiters)) 
+  if (!heap_empty (&sema->waiters)) 
     {
-      struct thread *t = list_entry (list_max (&sema->waiters, &cmp_list_pri, NULL),
-                                     struct thread, elem);
-      list_remove (&t->elem);
+      struct thread *t = heap_entry (heap_pop_max (&sema->waiters),
+                                     struct thread, wait_elem);
+      t->wait_heap = NULL;
       thread_unblock (t);
     }
   sema->value++;
@@ -196,6 +270,17 @@ lock_init (struct lock *lock)
 
   lock->holder = NULL;
   sema_init (&lock->semaphore, 1);
+  lock->stat = NULL;
+}
+
+/* Names LOCK, so that its acquisitions are counted and timed if
+   lock statistics are enabled.  NAME is copied. */
+void
+lock_set_name (struct lock *lock, const char *name)
+{
+  ASSERT (lock != NULL);
+
+  lock->stat = lockstat_register (name);
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -209,15 +294,30 @@ lock_init (struct lock *lock)
 void
 lock_acquire (struct lock *lock)
 {
+  enum intr_level old_level;
+  uint64_t start = 0;
+  bool contended = false;
+
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
   ASSERT (&thread_current ()->lock_list != NULL);
 
+  if (lock->stat != NULL)
+    {
+      start = rdtsc ();
+      contended = lock->semaphore.value == 0;
+    }
+  old_level = intr_disable ();
+  thread_current ()->waiting_lock = lock;
   sema_down (&lock->semaphore);
+  thread_current ()->waiting_lock = NULL;
+  intr_set_level (old_level);
+  if (lock->stat != NULL)
+    lockstat_acquired (lock->stat, start, contended);
   lock->holder = thread_current ();
   list_push_back (&thread_current ()->lock_list, &lock->lock_elem);
-  if (!list_empty (&lock->semaphore.waiters))
+  if (!heap_empty (&lock->semaphore.waiters))
     thread_set_priority (thread_current ()->priority);
 }
 
@@ -237,7 +337,11 @@ lock_try_acquire (struct lock *lock)
 
   success = sema_try_down (&lock->semaphore);
   if (success)
+    {
       lock->holder = thread_current ();
+      if (lock->stat != NULL)
+        lockstat_acquired (lock->stat, rdtsc (), false);
+    }
   return success;
 }
 
@@ -253,6 +357,8 @@ lock_release (struct lock *lock)
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
   
+  if (lock->stat != NULL)
+    lockstat_released (lock->stat);
   lock->holder = NULL;
   list_remove (&lock->lock_elem);
   sema_up (&lock->semaphore);
@@ -271,13 +377,31 @@ lock_held_by_current_thread (const struct lock *lock)
 
   return lock->holder == thread_current ();
 }
-/* One semaphore in a list. */
+/* One semaphore in a condition variable's waiters. */
 struct semaphore_elem 
   {
-    struct list_elem elem;              /* List element. */
+    struct heap_elem elem;              /* Heap element. */
     struct semaphore semaphore;         /* This semaphore. */
+    struct thread *thread;              /* Thread waiting on it. */
+    unsigned seq;                       /* When it started waiting. */
   };
 
+/* Orders condition variable waiters like wait_less(), by the
+   priority of their waiting threads. */
+static bool
+cond_waiter_less (const struct heap_elem *a_, const struct heap_elem *b_,
+                  void *aux UNUSED)
+{
+  const struct semaphore_elem *a
+    = heap_entry (a_, struct semaphore_elem, elem);
+  const struct semaphore_elem *b
+    = heap_entry (b_, struct semaphore_elem, elem);
+
+  if (a->thread->wait_priority != b->thread->wait_priority)
+    return a->thread->wait_priority < b->thread->wait_priority;
+  return (int) (a->seq - b->seq) > 0;
+}
+
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
@@ -286,7 +410,7 @@ cond_init (struct condition *cond)
 {
   ASSERT (cond != NULL);
 
-  list_init (&cond->waiters);
+  heap_init (&cond->waiters, cond_waiter_less, NULL);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -312,7 +436,9 @@ cond_init (struct condition *cond)
 void
 cond_wait (struct condition *cond, struct lock *lock) 
 {
+  struct thread *cur = thread_current ();
   struct semaphore_elem waiter;
+  enum intr_level old_level;
 
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
@@ -320,29 +446,19 @@ cond_wait (struct condition *cond, struct lock *lock)
   ASSERT (lock_held_by_current_thread (lock));
   
   sema_init (&waiter.semaphore, 0);
-  list_push_back (&cond->waiters, &waiter.elem);
+  waiter.thread = cur;
+  old_level = intr_disable ();
+  waiter.seq = wait_seq++;
+  cur->wait_priority = get_pri (cur);
+  cur->cond_heap = &cond->waiters;
+  cur->cond_elem = &waiter.elem;
+  heap_insert (&cond->waiters, &waiter.elem);
+  intr_set_level (old_level);
   lock_release (lock);
   sema_down (&waiter.semaphore);
   lock_acquire (lock);
 }
 
-/* Comparator function for highest priority among a list of semaphores */
-
-bool
-cmp_cond_pri (const struct list_elem *a, const struct list_elem *b,
-              void *aux UNUSED)
-{
-  struct semaphore_elem *x = list_entry(a, struct semaphore_elem, elem);
-  struct semaphore_elem *y = list_entry(b, struct semaphore_elem, elem);
-
-  struct thread *n = list_entry (list_max (&x->semaphore.waiters,
-                     &cmp_list_pri, NULL), struct thread, elem);
-  struct thread *m = list_entry (list_max (&y->semaphore.waiters,
-                     &cmp_list_pri, NULL), struct thread, elem);
-  if(get_pri (n) < get_pri(m)) return true;
-  else return false;
-}
-
 /* If any threads are waiting on COND (protected by LOCK), then
    this function signals one of them to wake up from its wait.
    LOCK must be held before calling this function.
@@ -359,14 +475,17 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED)
   ASSERT (lock_held_by_current_thread (lock));
   
   struct semaphore_elem *s;
+  enum intr_level old_level;
 
-  if (!list_empty (&cond->waiters)) 
+  old_level = intr_disable ();
+  if (!heap_empty (&cond->waiters)) 
     {
-      s = list_entry (list_max (&cond->waiters, &cmp_cond_pri, NULL),
-          struct semaphore_elem, elem);
+      s = heap_entry (heap_pop_max (&cond->waiters),
+                      struct semaphore_elem, elem);
+      s->thread->cond_heap = NULL;
       sema_up (&s->semaphore);
-      list_remove (&s->elem);
     }
+  intr_set_level (old_level);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -381,6 +500,345 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
 
-  while (!list_empty (&cond->waiters))
+  while (!heap_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+/* Initializes RWLOCK.  A reader-writer lock may be held by any
+   number of readers at once, or by a single writer.
+
+   Writers are preferred: once a writer is waiting, new readers
+   wait behind it, so that a steady stream of readers cannot
+   starve writers.  Like a lock, a reader-writer lock must be
+   released by the thread that acquired it, and it is not
+   recursive. */
+void
+rwlock_init (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_init (&rw->lock);
+  cond_init (&rw->readers_ok);
+  cond_init (&rw->writers_ok);
+  rw->reader_cnt = 0;
+  rw->peak_reader_cnt = 0;
+  rw->waiting_writers = 0;
+  rw->writer = NULL;
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or
+   is waiting for it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (rw->writer != thread_current ());
+
+  lock_acquire (&rw->lock);
+  while (rw->writer != NULL || rw->waiting_writers > 0)
+    cond_wait (&rw->readers_ok, &rw->lock);
+  if (++rw->reader_cnt > rw->peak_reader_cnt)
+    rw->peak_reader_cnt = rw->reader_cnt;
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread must hold for reading.
+   The last reader out lets a waiting writer in. */
+void
+rwlock_release_read (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  ASSERT (rw->reader_cnt > 0);
+  if (--rw->reader_cnt == 0 && rw->waiting_writers > 0)
+    cond_signal (&rw->writers_ok, &rw->lock);
+  lock_release (&rw->lock);
+}
+
+/* Acquires RW for writing, sleeping until no reader or other
+   writer holds it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (rw->writer != thread_current ());
+
+  lock_acquire (&rw->lock);
+  rw->waiting_writers++;
+  while (rw->writer != NULL || rw->reader_cnt > 0)
+    cond_wait (&rw->writers_ok, &rw->lock);
+  rw->waiting_writers--;
+  rw->writer = thread_current ();
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread must hold for writing.
+   Hands RW to the next waiting writer if there is one, otherwise
+   to all waiting readers. */
+void
+rwlock_release_write (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (rwlock_held_for_write (rw));
+
+  lock_acquire (&rw->lock);
+  rw->writer = NULL;
+  if (rw->waiting_writers > 0)
+    cond_signal (&rw->writers_ok, &rw->lock);
+  else
+    cond_broadcast (&rw->readers_ok, &rw->lock);
+  lock_release (&rw->lock);
+}
+
+/* Returns true if the current thread holds RW for writing, false
+   otherwise. */
+bool
+rwlock_held_for_write (const struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  return rw->writer == thread_current ();
+}
+
+/* Tells the processor that it is in a spin-wait loop, which
+   saves power and avoids a pipeline flush on exit from the loop.
+   See [IA32-v2b] "PAUSE". */
+static inline void
+cpu_relax (void)
+{
+  asm volatile ("pause" : : : "memory");
+}
+
+/* Atomically stores NEW into *P and returns the old value. */
+static inline int
+atomic_xchg (volatile int *p, int new)
+{
+  asm volatile ("xchgl %0, %1" : "+r" (new), "+m" (*p) : : "memory");
+  return new;
+}
+
+/* Atomically adds N to *P and returns the old value. */
+static inline unsigned
+atomic_fetch_add (volatile unsigned *p, unsigned n)
+{
+  asm volatile ("lock xaddl %0, %1" : "+r" (n), "+m" (*p) : : "memory");
+  return n;
+}
+
+/* Initializes spinlock S as free. */
+void
+spinlock_init (struct spinlock *s)
+{
+  ASSERT (s != NULL);
+
+  s->locked = 0;
+  s->holder = NULL;
+  s->stat = NULL;
+}
+
+/* Names S, so that its acquisitions are counted and timed if
+   lock statistics are enabled.  NAME is copied. */
+void
+spinlock_set_name (struct spinlock *s, const char *name)
+{
+  ASSERT (s != NULL);
+
+  s->stat = lockstat_register (name);
+}
+
+/* Disables interrupts and acquires S, spinning until it is
+   available.  Returns the previous interrupt level, which must
+   be passed to spinlock_release().  S must not already be held
+   by the current thread.
+
+   This function does not sleep, so it may be called within an
+   interrupt handler. */
+enum intr_level
+spinlock_acquire (struct spinlock *s)
+{
+  enum intr_level old_level;
+  uint64_t start = 0;
+  bool contended = false;
+
+  ASSERT (s != NULL);
+
+  old_level = intr_disable ();
+  ASSERT (!spinlock_held_by_current_thread (s));
+  if (s->stat != NULL)
+    start = rdtsc ();
+  while (atomic_xchg (&s->locked, 1))
+    {
+      contended = true;
+      while (s->locked)
+        cpu_relax ();
+    }
+  if (s->stat != NULL)
+    lockstat_acquired (s->stat, start, contended);
+  s->holder = thread_current ();
+  return old_level;
+}
+
+/* Releases S, which must be held by the current thread, and
+   restores interrupts to OLD_LEVEL, as returned by
+   spinlock_acquire(). */
+void
+spinlock_release (struct spinlock *s, enum intr_level old_level)
+{
+  ASSERT (s != NULL);
+  ASSERT (spinlock_held_by_current_thread (s));
+
+  if (s->stat != NULL)
+    lockstat_released (s->stat);
+  s->holder = NULL;
+  barrier ();
+  s->locked = 0;
+  intr_set_level (old_level);
+}
+
+/* Returns true if the current thread holds S, false
+   otherwise. */
+bool
+spinlock_held_by_current_thread (const struct spinlock *s)
+{
+  ASSERT (s != NULL);
+
+  return s->locked && s->holder == thread_current ();
+}
+
+/* Initializes ticket lock T as free. */
+void
+ticketlock_init (struct ticketlock *t)
+{
+  ASSERT (t != NULL);
+
+  t->next = 0;
+  t->owner = 0;
+  t->holder = NULL;
+}
+
+/* Disables interrupts, takes the next ticket for T, and spins
+   until that ticket is served.  Returns the previous interrupt
+   level, which must be passed to ticketlock_release().  T must
+   not already be held by the current thread.
+
+   This function does not sleep, so it may be called within an
+   interrupt handler. */
+enum intr_level
+ticketlock_acquire (struct ticketlock *t)
+{
+  enum intr_level old_level;
+  unsigned ticket;
+
+  ASSERT (t != NULL);
+
+  old_level = intr_disable ();
+  ASSERT (!ticketlock_held_by_current_thread (t));
+  ticket = atomic_fetch_add (&t->next, 1);
+  while (t->owner != ticket)
+    cpu_relax ();
+  t->holder = thread_current ();
+  return old_level;
+}
+
+/* Releases T, which must be held by the current thread, to the
+   next ticket in line, and restores interrupts to OLD_LEVEL, as
+   returned by ticketlock_acquire(). */
+void
+ticketlock_release (struct ticketlock *t, enum intr_level old_level)
+{
+  ASSERT (t != NULL);
+  ASSERT (ticketlock_held_by_current_thread (t));
+
+  t->holder = NULL;
+  barrier ();
+  t->owner++;
+  intr_set_level (old_level);
+}
+
+/* Returns true if the current thread holds T, false
+   otherwise. */
+bool
+ticketlock_held_by_current_thread (const struct ticketlock *t)
+{
+  ASSERT (t != NULL);
+
+  return t->next != t->owner && t->holder == thread_current ();
+}
+
+/* Initializes sequence lock SL. */
+void
+seqlock_init (struct seqlock *sl)
+{
+  ASSERT (sl != NULL);
+
+  sl->seq = 0;
+  spinlock_init (&sl->lock);
+}
+
+/* Starts a read of the data protected by SL.  Returns a sequence
+   number to pass to seqlock_read_retry() once the data has been
+   copied.  Waits for a write in progress on another processor to
+   finish.  Takes no lock and never sleeps, so it may be called
+   within an interrupt handler. */
+unsigned
+seqlock_read_begin (const struct seqlock *sl)
+{
+  unsigned seq;
+
+  ASSERT (sl != NULL);
+
+  while ((seq = sl->seq) & 1)
+    cpu_relax ();
+  barrier ();
+  return seq;
+}
+
+/* Returns true if the data read since seqlock_read_begin()
+   returned SEQ may be inconsistent because a writer changed it,
+   in which case the read must be repeated. */
+bool
+seqlock_read_retry (const struct seqlock *sl, unsigned seq)
+{
+  ASSERT (sl != NULL);
+
+  barrier ();
+  return sl->seq != seq;
+}
+
+/* Starts an update of the data protected by SL, excluding other
+   writers.  Returns the previous interrupt level, which must be
+   passed to seqlock_write_end(). */
+enum intr_level
+seqlock_write_begin (struct seqlock *sl)
+{
+  enum intr_level old_level;
+
+  ASSERT (sl != NULL);
+
+  old_level = spinlock_acquire (&sl->lock);
+  sl->seq++;
+  barrier ();
+  return old_level;
+}
+
+/* Finishes an update of the data protected by SL and restores
+   interrupts to OLD_LEVEL, as returned by seqlock_write_begin(). */
+void
+seqlock_write_end (struct seqlock *sl, enum intr_level old_level)
+{
+  ASSERT (sl != NULL);
+  ASSERT ((sl->seq & 1) != 0);
+
+  barrier ();
+  sl->seq++;
+  spinlock_release (&sl->lock, old_level);
+}
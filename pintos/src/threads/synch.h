@@ -1,17 +1,21 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
 #include <stdbool.h>
+#include "threads/interrupt.h"
 
 /* A counting semaphore. */
 struct semaphore 
   {
     unsigned value;             /* Current value. */
-    struct list waiters;        /* List of waiting threads. */
+    struct heap waiters;        /* Waiting threads, by priority. */
+    struct lockstat *stat;      /* Statistics, if named. */
   };
 
 void sema_init (struct semaphore *, unsigned value);
+void sema_set_name (struct semaphore *, const char *name);
 void sema_down (struct semaphore *);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
@@ -23,9 +27,11 @@ struct lock
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
     struct list_elem lock_elem; /* Element for holder's lock list. */
+    struct lockstat *stat;      /* Statistics, if named. */
   };
 
 void lock_init (struct lock *);
+void lock_set_name (struct lock *, const char *name);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
@@ -34,7 +40,7 @@ bool lock_held_by_current_thread (const struct lock *);
 /* Condition variable. */
 struct condition 
   {
-    struct list waiters;        /* List of waiting threads. */
+    struct heap waiters;        /* Waiting threads, by priority. */
   };
 
 void cond_init (struct condition *);
@@ -42,6 +48,91 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Reader-writer lock. */
+struct rwlock
+  {
+    struct lock lock;           /* Protects the members below. */
+    struct condition readers_ok; /* Signaled when readers may enter. */
+    struct condition writers_ok; /* Signaled when a writer may enter. */
+    int reader_cnt;             /* Number of readers holding the lock. */
+    int peak_reader_cnt;        /* Most readers ever holding it at once. */
+    int waiting_writers;        /* Number of writers waiting. */
+    struct thread *writer;      /* Writer holding the lock, if any. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_for_write (const struct rwlock *);
+
+/* Spinlock.
+
+   Unlike a lock, a spinlock never sleeps: acquiring it disables
+   interrupts on the current processor, then busy-waits for any
+   other processor to release it.  It is cheap, may be used in
+   interrupt handlers, and must only protect short critical
+   sections that do not sleep. */
+struct spinlock
+  {
+    volatile int locked;        /* 1 if held, 0 if free. */
+    struct thread *holder;      /* Thread holding lock (for debugging). */
+    struct lockstat *stat;      /* Statistics, if named. */
+  };
+
+void spinlock_init (struct spinlock *);
+void spinlock_set_name (struct spinlock *, const char *name);
+enum intr_level spinlock_acquire (struct spinlock *);
+void spinlock_release (struct spinlock *, enum intr_level);
+bool spinlock_held_by_current_thread (const struct spinlock *);
+
+/* Ticket lock.
+
+   A spinlock that is granted in the order it was requested, so
+   that no processor can be starved by others repeatedly winning
+   the race for it. */
+struct ticketlock
+  {
+    volatile unsigned next;     /* Next ticket to hand out. */
+    volatile unsigned owner;    /* Ticket now holding the lock. */
+    struct thread *holder;      /* Thread holding lock (for debugging). */
+  };
+
+void ticketlock_init (struct ticketlock *);
+enum intr_level ticketlock_acquire (struct ticketlock *);
+void ticketlock_release (struct ticketlock *, enum intr_level);
+bool ticketlock_held_by_current_thread (const struct ticketlock *);
+
+/* Sequence lock.
+
+   Protects read-mostly data.  Writers serialize on a spinlock and
+   bump a sequence number before and after each update; readers
+   take no lock at all, but retry if the sequence number shows
+   that a write was in progress or happened while they read:
+
+        unsigned seq;
+        do
+          {
+            seq = seqlock_read_begin (&sl);
+            ...copy the data...
+          }
+        while (seqlock_read_retry (&sl, seq));
+
+   Readers must tolerate seeing inconsistent data inside the
+   loop, so they should only copy it. */
+struct seqlock
+  {
+    volatile unsigned seq;      /* Odd while a write is in progress. */
+    struct spinlock lock;       /* Serializes writers. */
+  };
+
+void seqlock_init (struct seqlock *);
+unsigned seqlock_read_begin (const struct seqlock *);
+bool seqlock_read_retry (const struct seqlock *, unsigned seq);
+enum intr_level seqlock_write_begin (struct seqlock *);
+void seqlock_write_end (struct seqlock *, enum intr_level);
+
 /* Added Functions */
 int get_priority (struct thread *);
 
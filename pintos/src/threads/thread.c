@@ -1,16 +1,22 @@
 #include "threads/thread.h"
 #include <debug.h>
+#include <inttypes.h>
 #include <stddef.h>
 #include <random.h>
+#include <round.h>
 #include <stdio.h>
 #include <string.h>
+#include "devices/timer.h"
+#include "threads/cpu.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -37,6 +43,31 @@ static struct thread *initial_thread;
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
+/* Pages of exited threads, kept for reuse by thread_create() so
+   that churning threads need not go through the page allocator.
+   init_thread() resets the struct thread and alloc_frame() the
+   stack frames, so a page need not be zeroed between uses. */
+#define THREAD_CACHE_MAX 16
+static void *thread_cache[THREAD_CACHE_MAX];
+static size_t thread_cache_cnt;
+static struct spinlock thread_cache_lock;
+static unsigned long long thread_cache_hits;    /* Pages reused. */
+static unsigned long long thread_cache_misses;  /* Pages allocated. */
+
+/* CPU accounting of the most recently exited threads, for the
+   table printed by thread_print_stats().  Oldest entries are
+   overwritten first. */
+#define THREAD_HISTORY 16
+struct thread_usage
+  {
+    tid_t tid;                  /* Thread identifier. */
+    char name[16];              /* Name. */
+    bool exited;                /* True if the thread has exited. */
+    struct rusage usage;        /* Accounting. */
+  };
+static struct thread_usage exited_threads[THREAD_HISTORY];
+static unsigned exited_cnt;
+
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame 
   {
@@ -54,11 +85,73 @@ static long long user_ticks;    /* # of timer ticks in user programs. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
 static unsigned thread_ticks;   /* # of timer ticks since last yield. */
 
+/* Earliest-deadline-first scheduling class.
+
+   A thread joins the class with thread_set_edf(), declaring that
+   every PERIOD ticks it releases a job needing at most RUNTIME
+   ticks of CPU that must finish within DEADLINE ticks of its
+   release.  Ready EDF threads always run before other threads,
+   earliest absolute deadline first.  A job ends when the thread
+   calls thread_edf_yield(); the thread then sleeps until its
+   next release.
+
+   Each EDF thread reserves RUNTIME / DEADLINE of the CPU, and
+   admission fails if the reservations would exceed EDF_MAX_BW,
+   which keeps EDF schedulable and leaves some time for other
+   threads.  A job that uses up its RUNTIME is throttled until
+   its next release, so that an overrunning thread cannot steal
+   time reserved by the others; that job has missed its
+   deadline.
+
+   EDF threads do not take part in priority donation, so a lock
+   held by a non-EDF thread can still delay them. */
+#define EDF_UNIT 1000000        /* Bandwidth of the whole CPU. */
+#define EDF_MAX_BW (EDF_UNIT / 100 * 95)        /* Most reservable. */
+static int64_t edf_reserved;    /* Bandwidth reserved by EDF threads. */
+static unsigned long long edf_jobs;     /* Jobs completed. */
+static unsigned long long edf_misses;   /* Deadlines missed. */
+static struct list edf_list;    /* Ready EDF threads, by deadline. */
+static struct list edf_throttled;       /* EDF threads awaiting release. */
+
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* If true, use the fair scheduler.
+   Controlled by kernel command-line option "-cfs". */
+bool thread_cfs;
+
+/* Fair scheduler.
+
+   Each thread has a weight set by its priority: PRI_DEFAULT
+   weighs CFS_WEIGHT_0, and each step up in priority multiplies
+   the weight by 1.25, so that a thread's share of the CPU is in
+   proportion to its weight.  A thread's virtual runtime is the
+   CPU time it has used, in TSC cycles, scaled by CFS_WEIGHT_0
+   divided by its weight, and the ready thread with the least
+   virtual runtime runs next.  Ready threads are kept in a
+   red-black tree ordered by virtual runtime, so that picking
+   the next thread takes constant time and queuing one takes
+   O(log n) time.
+
+   Every ready thread should run once every CFS_LATENCY ticks,
+   so the running thread's time slice is its weight's share of
+   that period, but at least CFS_MIN_SLICE ticks; with many
+   ready threads the period is stretched instead.  A thread that
+   wakes up gets at least the smallest virtual runtime among
+   the threads that can run, so that it cannot hog the CPU to
+   catch up on the time it spent blocked.
+
+   EDF threads still run ahead of all others. */
+#define CFS_WEIGHT_0 1024       /* Weight of PRI_DEFAULT. */
+#define CFS_LATENCY 8           /* Scheduling period, in ticks. */
+#define CFS_MIN_SLICE 1         /* Shortest time slice, in ticks. */
+static int64_t cfs_weights[PRI_MAX + 1];        /* Indexed by priority. */
+static struct rbtree cfs_tree;  /* Ready threads by vruntime. */
+static int64_t cfs_min_vruntime;        /* Floor for vruntime of new threads. */
+static int64_t cfs_load;        /* Total weight of cfs_tree. */
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
@@ -70,6 +163,20 @@ static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
+static work_func free_thread_page;
+static void *get_thread_page (void);
+static bool cache_thread_page (void *);
+static void yield (bool voluntary);
+static void ready_push (struct thread *);
+static void edf_release (int64_t now);
+static list_less_func edf_deadline_less;
+static list_less_func edf_release_less;
+static void cfs_charge (struct thread *, uint64_t now);
+static bool cfs_slice_expired (struct thread *);
+static rb_less_func cfs_less;
+static void save_usage (struct thread_usage *, const struct thread *,
+                        bool exited);
+static void print_usage_table (void);
 
 
 /* helper function for cmp_lock_priority that finds the max of two ints */
@@ -80,6 +187,54 @@ max_pri(int a, int b)
 	return (a < b ? b:a);
 }
 
+/* Frees the page of dying thread T.  Run by a worker thread. */
+static void
+free_thread_page (void *t)
+{
+  palloc_free_page (t);
+}
+
+/* Returns a page for a new thread, from the cache of exited
+   threads' pages if possible, or a null pointer if memory is
+   exhausted.  The page's contents are arbitrary. */
+static void *
+get_thread_page (void) 
+{
+  enum intr_level old_level;
+  void *page = NULL;
+
+  old_level = spinlock_acquire (&thread_cache_lock);
+  if (thread_cache_cnt > 0)
+    {
+      page = thread_cache[--thread_cache_cnt];
+      thread_cache_hits++;
+    }
+  else
+    thread_cache_misses++;
+  spinlock_release (&thread_cache_lock, old_level);
+
+  if (page == NULL)
+    page = palloc_get_page (0);
+  return page;
+}
+
+/* Keeps PAGE, which belonged to an exited thread, for reuse by
+   get_thread_page().  Returns false if the cache is full, in
+   which case the caller must free PAGE. */
+static bool
+cache_thread_page (void *page) 
+{
+  enum intr_level old_level;
+  bool cached;
+
+  old_level = spinlock_acquire (&thread_cache_lock);
+  cached = thread_cache_cnt < THREAD_CACHE_MAX;
+  if (cached)
+    thread_cache[thread_cache_cnt++] = page;
+  spinlock_release (&thread_cache_lock, old_level);
+  return cached;
+}
+
 static bool
 cmp_priority (const struct list_elem *a, const struct list_elem *b, void *aux UNUSED)
 {
@@ -107,9 +262,9 @@ get_pri (struct thread *r)
         {
           l = list_entry (e, struct lock, lock_elem);
   
-          if (!list_empty (&l->semaphore.waiters))
+          if (!heap_empty (&l->semaphore.waiters))
             {
-              t = list_entry (list_max (&l->semaphore.waiters, cmp_priority, NULL), struct thread, elem);
+              t = heap_entry (heap_max (&l->semaphore.waiters), struct thread, wait_elem);
               tmp_pri = get_pri (t);
               if (tmp_pri > max_priority)
                 max_priority = tmp_pri;
@@ -160,11 +315,25 @@ thread_set_priority (int new_priority)
 void
 thread_init (void) 
 {
+  int i;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
+  /* Fair scheduler weights, 1.25 times larger per priority. */
+  cfs_weights[PRI_DEFAULT] = CFS_WEIGHT_0;
+  for (i = PRI_DEFAULT + 1; i <= PRI_MAX; i++)
+    cfs_weights[i] = cfs_weights[i - 1] * 5 / 4;
+  for (i = PRI_DEFAULT - 1; i >= PRI_MIN; i--)
+    cfs_weights[i] = cfs_weights[i + 1] * 4 / 5 > 0
+                     ? cfs_weights[i + 1] * 4 / 5 : 1;
+
   lock_init (&tid_lock);
+  spinlock_init (&thread_cache_lock);
   list_init (&ready_list);
   list_init (&all_list);
+  list_init (&edf_list);
+  list_init (&edf_throttled);
+  rb_init (&cfs_tree, cfs_less, NULL);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
@@ -191,24 +360,47 @@ thread_start (void)
 }
 
 /* Called by the timer interrupt handler at each timer tick.
-   Thus, this function runs in an external interrupt context. */
+   Thus, this function runs in an external interrupt context.
+   USER is true if the tick interrupted user code. */
 void
-thread_tick (void) 
+thread_tick (bool user) 
 {
   struct thread *t = thread_current ();
-
   /* Update statistics. */
   if (t == idle_thread)
     idle_ticks++;
-#ifdef USERPROG
-  else if (t->pagedir != NULL)
+  else if (user)
     user_ticks++;
-#endif
   else
     kernel_ticks++;
+  if (user)
+    t->usage.user_ticks++;
+  else
+    t->usage.kernel_ticks++;
+
+  /* Enforce EDF budgets and release throttled jobs. */
+  if (t->edf && --t->edf_budget <= 0)
+    {
+      t->edf_throttled = true;
+      intr_yield_on_return ();
+    }
+  if (!list_empty (&edf_throttled))
+    edf_release (timer_ticks ());
+  if (!list_empty (&edf_list)
+      && (!t->edf
+          || list_entry (list_front (&edf_list), struct thread,
+                         elem)->edf_abs_deadline < t->edf_abs_deadline))
+    intr_yield_on_return ();
 
   /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE)
+  thread_ticks++;
+  if (thread_cfs)
+    {
+      cfs_charge (t, rdtsc ());
+      if (cfs_slice_expired (t))
+        intr_yield_on_return ();
+    }
+  else if (thread_ticks >= TIME_SLICE)
     intr_yield_on_return ();
 }
 
@@ -218,6 +410,60 @@ thread_print_stats (void)
 {
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+  printf ("Thread pages: %llu reused, %llu allocated\n",
+          thread_cache_hits, thread_cache_misses);
+  printf ("EDF: %llu jobs, %llu deadline misses\n", edf_jobs, edf_misses);
+  print_usage_table ();
+}
+
+/* Prints the CPU accounting of each live thread and of the most
+   recently exited ones.  The entries are copied out with
+   interrupts off, because printing may block. */
+static void
+print_usage_table (void)
+{
+  enum { TABLE_MAX = 64 };
+  static struct thread_usage table[TABLE_MAX];
+  size_t cnt = 0;
+  size_t i;
+  struct list_elem *e;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  for (e = list_begin (&all_list);
+       e != list_end (&all_list) && cnt < TABLE_MAX - THREAD_HISTORY;
+       e = list_next (e))
+    save_usage (&table[cnt++], list_entry (e, struct thread, allelem), false);
+  for (i = exited_cnt > THREAD_HISTORY ? exited_cnt - THREAD_HISTORY : 0;
+       i < exited_cnt; i++)
+    table[cnt++] = exited_threads[i % THREAD_HISTORY];
+  intr_set_level (old_level);
+
+  printf ("Thread usage:\n"
+          "  tid name             user kernel  vcsw  icsw"
+          "   runq cycles  max runq cycles   blocked cycles\n");
+  for (i = 0; i < cnt; i++)
+    {
+      const struct thread_usage *u = &table[i];
+      printf ("%5d %-16s%c%5llu %6llu %5"PRIu32" %5"PRIu32
+              " %13llu %16llu %16llu\n",
+              u->tid, u->name, u->exited ? '*' : ' ',
+              u->usage.user_ticks, u->usage.kernel_ticks,
+              u->usage.voluntary_switches, u->usage.involuntary_switches,
+              u->usage.runq_cycles, u->usage.runq_max_cycles,
+              u->usage.blocked_cycles);
+    }
+  if (exited_cnt > 0)
+    printf ("  (* exited; %u threads exited in all)\n", exited_cnt);
+}
+
+/* Copies the running thread's CPU accounting into *USAGE. */
+void
+thread_get_rusage (struct rusage *usage)
+{
+  enum intr_level old_level = intr_disable ();
+  *usage = thread_current ()->usage;
+  intr_set_level (old_level);
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -249,13 +495,15 @@ thread_create (const char *name, int priority,
   ASSERT (function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = get_thread_page ();
   if (t == NULL)
     return TID_ERROR;
 
   /* Initialize thread. */
   init_thread (t, name, priority);
   tid = t->tid = allocate_tid ();
+  if (trace_enabled)
+    trace_name (tid, t->name);
 
   /* Prepare thread for first run by initializing its stack.
      Do this atomically so intermediate values for the 'stack' 
@@ -301,6 +549,9 @@ thread_block (void)
 
   get_pri (thread_current ());
   thread_current ()->status = THREAD_BLOCKED;
+  thread_current ()->usage.voluntary_switches++;
+  thread_current ()->state_start = rdtsc ();
+  TRACE (TRACE_BLOCK, thread_current ()->tid, 0, 0);
   schedule ();
 }
 
@@ -316,13 +567,20 @@ void
 thread_unblock (struct thread *t) 
 {
   enum intr_level old_level;
+  uint64_t now;
 
   ASSERT (is_thread (t));
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  list_push_back (&ready_list, &t->elem);
+  TRACE (TRACE_WAKEUP, t->tid, running_thread ()->tid, 0);
+  if (thread_cfs && t->vruntime < cfs_min_vruntime)
+    t->vruntime = cfs_min_vruntime;
+  ready_push (t);
   t->status = THREAD_READY;
+  now = rdtsc ();
+  t->usage.blocked_cycles += now - t->state_start;
+  t->state_start = now;
   intr_set_level (old_level);
   get_pri (t);
 }
@@ -375,6 +633,9 @@ thread_exit (void)
      and schedule another process.  That process will destroy us
      when it calls thread_schedule_tail(). */
   intr_disable ();
+  save_usage (&exited_threads[exited_cnt++ % THREAD_HISTORY],
+              thread_current (), true);
+  edf_reserved -= thread_current ()->edf_bandwidth;
   list_remove (&thread_current()->allelem);
   thread_current ()->status = THREAD_DYING;
   schedule ();
@@ -385,6 +646,23 @@ thread_exit (void)
    may be scheduled again immediately at the scheduler's whim. */
 void
 thread_yield (void) 
+{
+  yield (true);
+}
+
+/* Yields the CPU on behalf of the scheduler, as thread_yield()
+   does, but accounts the switch as involuntary.  Called on return
+   from an interrupt that requested preemption. */
+void
+thread_preempt (void) 
+{
+  yield (false);
+}
+
+/* Puts the running thread back on the run queue and schedules,
+   counting a VOLUNTARY or involuntary context switch. */
+static void
+yield (bool voluntary) 
 {
   struct thread *cur = thread_current ();
   enum intr_level old_level;
@@ -392,13 +670,103 @@ thread_yield (void)
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
-  if (cur != idle_thread) 
-    list_push_back (&ready_list, &cur->elem);
-  cur->status = THREAD_READY;
+
+  /* Charge the time just run before the thread is queued again,
+     since its virtual runtime orders the CFS run queue. */
+  if (thread_cfs)
+    cfs_charge (cur, rdtsc ());
+
+  if (cur->edf_throttled)
+    {
+      /* Out of budget: wait for the next release. */
+      list_insert_ordered (&edf_throttled, &cur->elem,
+                           edf_release_less, NULL);
+      cur->status = THREAD_BLOCKED;
+    }
+  else
+    {
+      if (cur != idle_thread) 
+        ready_push (cur);
+      cur->status = THREAD_READY;
+    }
+  if (voluntary)
+    cur->usage.voluntary_switches++;
+  else
+    cur->usage.involuntary_switches++;
+  cur->state_start = rdtsc ();
   schedule ();
   intr_set_level (old_level);
 }
 
+/* Puts the running thread in the EDF scheduling class: from now
+   on, every PERIOD ticks it is released a job of up to RUNTIME
+   ticks that should finish within DEADLINE ticks.  RUNTIME of 0
+   returns the thread to priority scheduling.  Returns false,
+   leaving the thread's scheduling unchanged, if the parameters
+   are invalid or admitting the thread would overcommit the
+   CPU. */
+bool
+thread_set_edf (int64_t runtime, int64_t period, int64_t deadline)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  int64_t bandwidth = 0;
+
+  if (runtime != 0)
+    {
+      if (runtime < 0 || deadline < runtime || period < deadline)
+        return false;
+      bandwidth = DIV_ROUND_UP (runtime * EDF_UNIT, deadline);
+    }
+
+  old_level = intr_disable ();
+  if (edf_reserved - cur->edf_bandwidth + bandwidth > EDF_MAX_BW)
+    {
+      intr_set_level (old_level);
+      return false;
+    }
+  edf_reserved += bandwidth - cur->edf_bandwidth;
+  cur->edf = runtime != 0;
+  cur->edf_throttled = cur->edf_late = false;
+  cur->edf_runtime = runtime;
+  cur->edf_period = period;
+  cur->edf_deadline = deadline;
+  cur->edf_bandwidth = bandwidth;
+  cur->edf_budget = runtime;
+  cur->edf_abs_deadline = timer_ticks () + deadline;
+  cur->edf_release = timer_ticks () + period;
+  intr_set_level (old_level);
+
+  /* Let the scheduler see the new class. */
+  thread_yield ();
+  return true;
+}
+
+/* Ends the running EDF thread's current job and sleeps until the
+   next one is released.  Returns true if the job finished by its
+   deadline, false if it missed it. */
+bool
+thread_edf_yield (void)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  bool met;
+
+  ASSERT (cur->edf);
+
+  old_level = intr_disable ();
+  met = !cur->edf_late && timer_ticks () <= cur->edf_abs_deadline;
+  if (!met && !cur->edf_late)
+    edf_misses++;
+  edf_jobs++;
+  list_insert_ordered (&edf_throttled, &cur->elem,
+                       edf_release_less, NULL);
+  thread_block ();
+  intr_set_level (old_level);
+
+  return met;
+}
+
 /* Invoke function 'func' on all threads, passing along 'aux'.
    This function must be called with interrupts off. */
 void
@@ -537,6 +905,7 @@ init_thread (struct thread *t, const char *name, int priority)
   t->priority = priority;
   t->base_priority = priority;
   t->magic = THREAD_MAGIC;
+  t->state_start = rdtsc ();
   t->new_fd = 2;
   list_push_back (&all_list, &t->allelem);
   list_init (&t->lock_list);
@@ -545,8 +914,9 @@ init_thread (struct thread *t, const char *name, int priority)
   sema_init (&t->exit_sema,0);
 }
 
-/* Allocates a SIZE-byte frame at the top of thread T's stack and
-   returns a pointer to the frame's base. */
+/* Allocates a SIZE-byte frame at the top of thread T's stack,
+   zeroes it, and returns a pointer to the frame's base.  (The
+   page may have belonged to another thread.) */
 static void *
 alloc_frame (struct thread *t, size_t size) 
 {
@@ -555,6 +925,7 @@ alloc_frame (struct thread *t, size_t size)
   ASSERT (size % sizeof (uint32_t) == 0);
 
   t->stack -= size;
+  memset (t->stack, 0, size);
   return t->stack;
 }
 
@@ -566,6 +937,18 @@ alloc_frame (struct thread *t, size_t size)
 static struct thread *
 next_thread_to_run (void) 
 {
+  if (!list_empty (&edf_list))
+    return list_entry (list_pop_front (&edf_list), struct thread, elem);
+  if (thread_cfs)
+    {
+      struct thread *t;
+
+      if (rb_empty (&cfs_tree))
+        return idle_thread;
+      t = rb_entry (rb_pop_min (&cfs_tree), struct thread, cfs_elem);
+      cfs_load -= t->cfs_weight;
+      return t;
+    }
   if (list_empty (&ready_list))
     return idle_thread;
   else
@@ -600,9 +983,24 @@ void
 thread_schedule_tail (struct thread *prev)
 {
   struct thread *cur = running_thread ();
+  uint64_t now = rdtsc ();
   
   ASSERT (intr_get_level () == INTR_OFF);
 
+  /* Charge the time since the thread stopped running.  Only the
+     idle thread is scheduled straight from the blocked state. */
+  if (cur->status == THREAD_READY)
+    {
+      uint64_t wait = now - cur->state_start;
+      cur->usage.runq_cycles += wait;
+      if (wait > cur->usage.runq_max_cycles)
+        cur->usage.runq_max_cycles = wait;
+    }
+  else
+    cur->usage.blocked_cycles += now - cur->state_start;
+  cur->state_start = now;
+  cur->cfs_charged = now;
+
   /* Mark us as running. */
   cur->status = THREAD_RUNNING;
 
@@ -618,11 +1016,18 @@ thread_schedule_tail (struct thread *prev)
      thread.  This must happen late so that thread_exit() doesn't
      pull out the rug under itself.  (We don't free
      initial_thread because its memory was not obtained via
-     palloc().) */
+     palloc().)  The page is kept for reuse if there is room in
+     the cache, otherwise freed by a worker thread, to keep the
+     page allocator out of the thread switch path; the work item
+     lives in the page itself. */
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) 
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      if (!cache_thread_page (prev))
+        {
+          work_init (&prev->free_work, free_thread_page, prev);
+          work_queue (&prev->free_work);
+        }
     }
 }
 
@@ -637,18 +1042,176 @@ static void
 schedule (void) 
 {
   struct thread *cur = running_thread ();
-  struct thread *next = next_thread_to_run ();
+  struct thread *next;
   struct thread *prev = NULL;
 
   ASSERT (intr_get_level () == INTR_OFF);
   ASSERT (cur->status != THREAD_RUNNING);
+
+  /* Charge a thread that blocked or is exiting for the time it
+     just ran.  A ready thread was already charged by yield()
+     before it went back into the run queue, whose order must not
+     change under it. */
+  if (thread_cfs && cur->status != THREAD_READY)
+    cfs_charge (cur, rdtsc ());
+
+  next = next_thread_to_run ();
   ASSERT (is_thread (next));
 
   if (cur != next)
-    prev = switch_threads (cur, next);
+    {
+      TRACE (TRACE_SWITCH, cur->tid, next->tid, cur->status);
+      prev = switch_threads (cur, next);
+    }
   thread_schedule_tail (prev);
 }
 
+/* Adds T to the run queue.  Interrupts must be off. */
+static void
+ready_push (struct thread *t)
+{
+  if (t->edf)
+    list_insert_ordered (&edf_list, &t->elem, edf_deadline_less, NULL);
+  else if (thread_cfs)
+    {
+      t->cfs_weight = cfs_weights[t->priority];
+      cfs_load += t->cfs_weight;
+      rb_insert (&cfs_tree, &t->cfs_elem);
+    }
+  else
+    list_push_back (&ready_list, &t->elem);
+}
+
+/* Charges T, which is running or was until just now on C, for
+   the CPU time it used since it was last charged, and advances
+   C's minimum virtual runtime. */
+static void
+cfs_charge (struct thread *t, uint64_t now)
+{
+  int64_t min_vruntime;
+
+  if (t != idle_thread)
+    t->vruntime += (int64_t) (now - t->cfs_charged) * CFS_WEIGHT_0
+                   / cfs_weights[t->priority];
+  t->cfs_charged = now;
+
+  /* Keep the minimum monotonic, since waking threads are
+     placed at it. */
+  min_vruntime = t != idle_thread ? t->vruntime : INT64_MAX;
+  if (!rb_empty (&cfs_tree))
+    {
+      int64_t first = rb_entry (rb_min (&cfs_tree), struct thread,
+                                cfs_elem)->vruntime;
+      if (first < min_vruntime)
+        min_vruntime = first;
+    }
+  if (min_vruntime != INT64_MAX && min_vruntime > cfs_min_vruntime)
+    cfs_min_vruntime = min_vruntime;
+}
+
+/* Returns true if running thread T has used up its time slice on
+   C: its weight's share of a period in which every ready thread
+   runs once. */
+static bool
+cfs_slice_expired (struct thread *t)
+{
+  int64_t weight = cfs_weights[t->priority];
+  int64_t period = CFS_LATENCY;
+  int64_t slice;
+  size_t ready = rb_size (&cfs_tree);
+
+  if (ready == 0)
+    return false;
+  if ((ready + 1) * CFS_MIN_SLICE > CFS_LATENCY)
+    period = (ready + 1) * CFS_MIN_SLICE;
+  slice = period * weight / (cfs_load + weight);
+  if (slice < CFS_MIN_SLICE)
+    slice = CFS_MIN_SLICE;
+  return thread_ticks >= slice;
+}
+
+/* Orders threads in a cfs_tree by virtual runtime. */
+static bool
+cfs_less (const struct rb_elem *a_, const struct rb_elem *b_,
+          void *aux UNUSED)
+{
+  const struct thread *a = rb_entry (a_, struct thread, cfs_elem);
+  const struct thread *b = rb_entry (b_, struct thread, cfs_elem);
+
+  return a->vruntime < b->vruntime;
+}
+
+/* Releases the next job of each EDF thread on C that is waiting
+   for a release due by NOW, giving it a fresh budget and
+   deadline.  A thread throttled in the middle of a job has
+   missed that job's deadline.  If a release is so late that its
+   deadline has already passed, the job is released as if at
+   NOW. */
+static void
+edf_release (int64_t now)
+{
+  while (!list_empty (&edf_throttled))
+    {
+      struct thread *t = list_entry (list_front (&edf_throttled),
+                                     struct thread, elem);
+      int64_t start = t->edf_release;
+
+      if (start > now)
+        break;
+      list_pop_front (&edf_throttled);
+
+      if (t->edf_throttled)
+        {
+          if (!t->edf_late)
+            edf_misses++;
+          t->edf_late = true;
+          t->edf_throttled = false;
+        }
+      else
+        t->edf_late = false;
+
+      if (start + t->edf_deadline <= now)
+        start = now;
+      t->edf_budget = t->edf_runtime;
+      t->edf_abs_deadline = start + t->edf_deadline;
+      t->edf_release = start + t->edf_period;
+      thread_unblock (t);
+    }
+}
+
+/* Orders EDF threads by absolute deadline. */
+static bool
+edf_deadline_less (const struct list_elem *a_, const struct list_elem *b_,
+                   void *aux UNUSED)
+{
+  const struct thread *a = list_entry (a_, struct thread, elem);
+  const struct thread *b = list_entry (b_, struct thread, elem);
+
+  return a->edf_abs_deadline < b->edf_abs_deadline;
+}
+
+/* Orders EDF threads by next release time. */
+static bool
+edf_release_less (const struct list_elem *a_, const struct list_elem *b_,
+                  void *aux UNUSED)
+{
+  const struct thread *a = list_entry (a_, struct thread, elem);
+  const struct thread *b = list_entry (b_, struct thread, elem);
+
+  return a->edf_release < b->edf_release;
+}
+
+/* Records T's identity and CPU accounting in *U.  EXITED says
+   whether T is exiting. */
+static void
+save_usage (struct thread_usage *u, const struct thread *t, bool exited)
+{
+  u->tid = t->tid;
+  strlcpy (u->name, t->name, sizeof u->name);
+  u->exited = exited;
+  u->usage = t->usage;
+}
+
 /* Returns a tid to use for a new thread. */
 static tid_t
 allocate_tid (void) 
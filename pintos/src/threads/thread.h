@@ -3,8 +3,11 @@
 
 #include <debug.h>
 #include <list.h>
+#include <rbtree.h>
+#include <rusage.h>
 #include <stdint.h>
 #include "threads/synch.h"
+#include "threads/workqueue.h"
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -115,13 +118,50 @@ struct thread
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
 
+    /* Owned by synch.c. */
+    struct heap_elem wait_elem;         /* Element in semaphore waiters. */
+    struct heap *wait_heap;             /* Heap holding wait_elem, if any. */
+    struct heap_elem *cond_elem;        /* Element in condition waiters. */
+    struct heap *cond_heap;             /* Heap holding cond_elem, if any. */
+    int wait_priority;                  /* Priority when last queued. */
+    unsigned wait_seq;                  /* Order in which waiting began. */
+    struct lock *waiting_lock;          /* Lock being acquired, if any. */
+
 
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
 #endif
 
+#ifdef FILESYS
+    /* Owned by filesys/journal.c. */
+    int journal_depth;                  /* Journal operations open. */
+#endif
+
     /* Owned by thread.c. */
+    struct rusage usage;                /* CPU accounting. */
+
+    /* Earliest-deadline-first scheduling, owned by thread.c.
+       Times are in timer ticks. */
+    bool edf;                           /* In the EDF class? */
+    bool edf_throttled;                 /* Budget ran out before job end? */
+    bool edf_late;                      /* Current job already missed? */
+    int64_t edf_runtime;                /* Budget per job. */
+    int64_t edf_period;                 /* Time between releases. */
+    int64_t edf_deadline;               /* Deadline, relative to release. */
+    int64_t edf_bandwidth;              /* Reserved share of the CPU. */
+    int64_t edf_budget;                 /* Budget left in current job. */
+    int64_t edf_abs_deadline;           /* Deadline of current job. */
+    int64_t edf_release;                /* Release time of next job. */
+
+    /* Fair scheduling, owned by thread.c. */
+    struct rb_elem cfs_elem;            /* Element in a cfs_tree. */
+    int64_t vruntime;                   /* Weighted CPU time, in cycles. */
+    int64_t cfs_weight;                 /* Weight while in a cfs_tree. */
+    uint64_t cfs_charged;               /* TSC when last charged. */
+
+    uint64_t state_start;               /* TSC when status last changed. */
+    struct work free_work;              /* Frees the page once dead. */
     unsigned magic;                     /* Detects stack overflow. */
   };
 
@@ -130,10 +170,16 @@ struct thread
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the fair scheduler, which shares the CPU among
+   ready threads in proportion to weights set by their
+   priorities.  Controlled by kernel command-line option
+   "-cfs". */
+extern bool thread_cfs;
+
 void thread_init (void);
 void thread_start (void);
 
-void thread_tick (void);
+void thread_tick (bool user);
 void thread_print_stats (void);
 
 typedef void thread_func (void *aux);
@@ -148,6 +194,10 @@ const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+void thread_preempt (void);
+bool thread_set_edf (int64_t runtime, int64_t period, int64_t deadline);
+bool thread_edf_yield (void);
+void thread_get_rusage (struct rusage *);
 
 /* Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func (struct thread *t, void *aux);
@@ -0,0 +1,184 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Scheduler event trace.
+
+   Events are recorded into a ring buffer without taking a lock:
+   a slot is claimed with an atomic increment of the ring's head,
+   which makes recording safe against interrupt handlers that
+   record events in the middle of another record.  When the ring
+   is full, the oldest events are overwritten.
+
+   Events carry the time-stamp counter.  trace_init() and
+   trace_dump() each note the counter at a timer tick, so that
+   the dump can state the counter's frequency.
+
+   trace_dump() prints the ring to the console at shutdown, as
+   lines that utils/pintos-trace2json converts to the Chrome
+   trace format, which chrome://tracing and Perfetto display.
+   The format is:
+
+        Trace: begin, HZ cycles per second
+        trace-name TID NAME
+        trace TSC TYPE TID ARG EXTRA
+        Trace: end, LOST events lost
+
+   Thread names are kept in a small table indexed by tid, so
+   names of long-gone threads may be missing from the dump. */
+
+/* A recorded event. */
+struct trace_event
+  {
+    uint64_t tsc;               /* Time-stamp counter. */
+    uint8_t type;               /* enum trace_type. */
+    uint16_t extra;             /* Type-specific. */
+    int32_t tid;                /* Thread the event is about. */
+    int32_t arg;                /* Type-specific. */
+  };
+
+/* Events in the ring.  Must be a power of 2. */
+#define TRACE_EVENTS 4096
+#define TRACE_PAGES \
+        DIV_ROUND_UP (TRACE_EVENTS * sizeof (struct trace_event), PGSIZE)
+
+/* Ring of events. */
+static struct trace_event *events;      /* TRACE_EVENTS events. */
+static volatile unsigned head;          /* Events ever recorded. */
+
+/* Names of traced threads, indexed by tid modulo TRACE_NAMES. */
+#define TRACE_NAMES 256
+struct trace_thread
+  {
+    int tid;                    /* Thread identifier, 0 if unused. */
+    char name[16];              /* Name. */
+  };
+static struct trace_thread names[TRACE_NAMES];
+
+/* Time-stamp counter and timer ticks when tracing started. */
+static uint64_t start_tsc;
+static int64_t start_ticks;
+
+bool trace_enabled;
+
+static const char *type_names[] =
+  {"switch", "wakeup", "block", "donate", "sys_enter", "sys_exit"};
+
+static thread_action_func name_thread;
+static int64_t wait_for_tick (uint64_t *tsc);
+
+/* Atomically adds 1 to *P and returns its old value. */
+static inline unsigned
+fetch_inc (volatile unsigned *p)
+{
+  unsigned old = 1;
+  asm volatile ("lock xaddl %0, %1" : "+r" (old), "+m" (*p) : : "memory");
+  return old;
+}
+
+/* Allocates the trace ring and starts recording events.  Must
+   be called after the timer is running. */
+void
+trace_init (void)
+{
+  enum intr_level old_level;
+
+  events = palloc_get_multiple (PAL_ZERO, TRACE_PAGES);
+  if (events == NULL)
+    PANIC ("trace buffer allocation failed");
+  head = 0;
+  start_ticks = wait_for_tick (&start_tsc);
+
+  old_level = intr_disable ();
+  thread_foreach (name_thread, NULL);
+  trace_enabled = true;
+  intr_set_level (old_level);
+}
+
+/* Records an event of the given TYPE about thread TID.  Use the
+   TRACE macro instead, which skips the call when tracing is
+   disabled. */
+void
+trace_record (enum trace_type type, int tid, int arg, int extra)
+{
+  struct trace_event *e;
+
+  e = &events[fetch_inc (&head) & (TRACE_EVENTS - 1)];
+  e->tsc = rdtsc ();
+  e->type = type;
+  e->extra = extra;
+  e->tid = tid;
+  e->arg = arg;
+}
+
+/* Records that thread TID is named NAME. */
+void
+trace_name (int tid, const char *name)
+{
+  struct trace_thread *t = &names[tid % TRACE_NAMES];
+
+  t->tid = tid;
+  strlcpy (t->name, name, sizeof t->name);
+}
+
+/* Stops tracing and prints the recorded events, oldest first. */
+void
+trace_dump (void)
+{
+  unsigned first = head > TRACE_EVENTS ? head - TRACE_EVENTS : 0;
+  uint64_t end_tsc, hz;
+  int64_t end_ticks;
+  unsigned i;
+
+  if (!trace_enabled)
+    return;
+  trace_enabled = false;
+
+  end_ticks = wait_for_tick (&end_tsc);
+  hz = end_ticks > start_ticks
+       ? (end_tsc - start_tsc) / (end_ticks - start_ticks) * TIMER_FREQ : 0;
+
+  printf ("Trace: begin, %"PRIu64" cycles per second\n", hz);
+  for (i = 0; i < TRACE_NAMES; i++)
+    if (names[i].tid != 0)
+      printf ("trace-name %d %s\n", names[i].tid, names[i].name);
+  for (i = first; i != head; i++)
+    {
+      const struct trace_event *e = &events[i & (TRACE_EVENTS - 1)];
+      printf ("trace %"PRIu64" %s %"PRId32" %"PRId32" %u\n",
+              e->tsc, type_names[e->type], e->tid, e->arg, e->extra);
+    }
+  printf ("Trace: end, %u events lost\n", first);
+}
+
+/* Records T's name.  For thread_foreach(). */
+static void
+name_thread (struct thread *t, void *aux UNUSED)
+{
+  trace_name (t->tid, t->name);
+}
+
+/* Waits for the next timer tick and returns its number, storing
+   the time-stamp counter at that moment in *TSC.  If interrupts
+   are off, returns the current tick without waiting. */
+static int64_t
+wait_for_tick (uint64_t *tsc)
+{
+  int64_t start = timer_ticks ();
+  int64_t now = start;
+
+  if (intr_get_level () == INTR_ON)
+    while (now == start)
+      now = timer_ticks ();
+  *tsc = rdtsc ();
+  return now;
+}
@@ -0,0 +1,39 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Kinds of scheduler trace events. */
+enum trace_type
+  {
+    TRACE_SWITCH,               /* TID switched to ARG; EXTRA is TID's status. */
+    TRACE_WAKEUP,               /* TID unblocked by ARG. */
+    TRACE_BLOCK,                /* TID blocked. */
+    TRACE_DONATE,               /* TID got priority EXTRA from ARG. */
+    TRACE_SYSCALL_ENTER,        /* TID entered system call ARG. */
+    TRACE_SYSCALL_EXIT          /* TID returned from system call ARG. */
+  };
+
+/* True while events are being recorded.  Set by trace_init() if
+   the kernel command-line option "-trace" is given. */
+extern bool trace_enabled;
+
+/* Records an event of the given TYPE, if tracing is enabled.
+   When it is not, this costs one test of a global flag, which
+   the compiler lays out as the not-taken branch, and the
+   arguments are not evaluated. */
+#define TRACE(TYPE, TID, ARG, EXTRA)                            \
+        do                                                      \
+          {                                                     \
+            if (__builtin_expect (trace_enabled, 0))            \
+              trace_record (TYPE, TID, ARG, EXTRA);             \
+          }                                                     \
+        while (0)
+
+void trace_init (void);
+void trace_record (enum trace_type, int tid, int arg, int extra);
+void trace_name (int tid, const char *name);
+void trace_dump (void);
+
+#endif /* threads/trace.h */
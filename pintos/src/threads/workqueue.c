@@ -0,0 +1,233 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Deferred work.
+
+   Work that need not, or must not, run where it arises, such as
+   in an interrupt handler or in the middle of a thread switch,
+   is packaged as a struct work and queued with work_queue().  A
+   pool of WORKER_CNT kernel threads runs queued items in the
+   order they were queued.  work_queue_delayed() instead holds an
+   item back until a given number of timer ticks have passed.
+
+   Items can be queued from any context, including interrupt
+   handlers, so the queues are protected by a spinlock and the
+   workers wait on a semaphore.  Workers run at PRI_MAX so that
+   work queued by an interrupt handler runs as soon as the
+   handler returns. */
+
+/* Number of worker threads. */
+#define WORKER_CNT 2
+
+/* Items ready to run, in the order queued. */
+static struct list run_list;
+
+/* Delayed items, in order of increasing due tick. */
+static struct list delayed_list;
+
+/* Protects run_list, delayed_list, each item's `pending' and
+   `due', and the statistics. */
+static struct spinlock workqueue_lock;
+
+/* Counts items in run_list. */
+static struct semaphore run_sema;
+
+/* Statistics. */
+static unsigned long long run_cnt;       /* Items run. */
+static unsigned long long delayed_cnt;   /* Items queued with a delay. */
+static uint64_t total_latency;           /* Cycles from queue to start. */
+static uint64_t max_latency;             /* Longest single latency. */
+
+static thread_func worker;
+static void enqueue (struct work *);
+static bool due_less (const struct list_elem *, const struct list_elem *,
+                      void *aux);
+
+/* Initializes the workqueue.  Items may be queued from then on,
+   but run only once workqueue_start() has been called. */
+void
+workqueue_init (void) 
+{
+  list_init (&run_list);
+  list_init (&delayed_list);
+  spinlock_init (&workqueue_lock);
+  sema_init (&run_sema, 0);
+}
+
+/* Starts the worker threads.  Must be called after
+   thread_start(). */
+void
+workqueue_start (void) 
+{
+  int i;
+
+  for (i = 0; i < WORKER_CNT; i++)
+    {
+      char name[16];
+
+      snprintf (name, sizeof name, "worker %d", i);
+      thread_create (name, PRI_MAX, worker, NULL);
+    }
+}
+
+/* Initializes work item W to run FUNC with argument AUX. */
+void
+work_init (struct work *w, work_func *func, void *aux) 
+{
+  ASSERT (w != NULL);
+  ASSERT (func != NULL);
+
+  w->func = func;
+  w->aux = aux;
+  w->pending = false;
+}
+
+/* Queues W to run as soon as a worker is free.  Returns true if
+   successful, false if W was already queued or delayed and has
+   not started running yet.
+
+   This function does not sleep, so it may be called within an
+   interrupt handler. */
+bool
+work_queue (struct work *w) 
+{
+  enum intr_level old_level;
+  bool queued;
+
+  ASSERT (w != NULL);
+
+  old_level = spinlock_acquire (&workqueue_lock);
+  queued = !w->pending;
+  if (queued)
+    {
+      w->pending = true;
+      enqueue (w);
+    }
+  spinlock_release (&workqueue_lock, old_level);
+  return queued;
+}
+
+/* Queues W to run once at least TICKS timer ticks have passed.
+   Returns true if successful, false if W was already queued or
+   delayed and has not started running yet.
+
+   This function does not sleep, so it may be called within an
+   interrupt handler. */
+bool
+work_queue_delayed (struct work *w, int64_t ticks) 
+{
+  enum intr_level old_level;
+  int64_t due = timer_ticks () + ticks;
+  bool queued;
+
+  ASSERT (w != NULL);
+
+  if (ticks <= 0)
+    return work_queue (w);
+
+  old_level = spinlock_acquire (&workqueue_lock);
+  queued = !w->pending;
+  if (queued)
+    {
+      w->pending = true;
+      w->due = due;
+      list_insert_ordered (&delayed_list, &w->elem, due_less, NULL);
+      delayed_cnt++;
+    }
+  spinlock_release (&workqueue_lock, old_level);
+  return queued;
+}
+
+/* Moves delayed items that are due at timer tick NOW to the run
+   queue.  Called by the timer interrupt handler. */
+void
+workqueue_tick (int64_t now) 
+{
+  enum intr_level old_level;
+
+  old_level = spinlock_acquire (&workqueue_lock);
+  while (!list_empty (&delayed_list))
+    {
+      struct work *w = list_entry (list_front (&delayed_list),
+                                   struct work, elem);
+      if (w->due > now)
+        break;
+      list_pop_front (&delayed_list);
+      enqueue (w);
+    }
+  spinlock_release (&workqueue_lock, old_level);
+}
+
+/* Prints workqueue statistics. */
+void
+workqueue_print_stats (void) 
+{
+  printf ("Workqueue: %llu items run (%llu delayed), "
+          "queue latency %"PRIu64" cycles average, %"PRIu64" max\n",
+          run_cnt, delayed_cnt,
+          run_cnt > 0 ? total_latency / run_cnt : 0, max_latency);
+}
+
+/* Adds W to the run queue and wakes a worker for it.  If called
+   by an interrupt handler, arranges for the worker to run as soon
+   as the handler returns.  The caller must hold workqueue_lock. */
+static void
+enqueue (struct work *w) 
+{
+  ASSERT (spinlock_held_by_current_thread (&workqueue_lock));
+
+  w->queued = rdtsc ();
+  list_push_back (&run_list, &w->elem);
+  sema_up (&run_sema);
+  if (intr_context ())
+    intr_yield_on_return ();
+}
+
+/* Worker thread: runs queued items forever. */
+static void
+worker (void *aux UNUSED) 
+{
+  for (;;)
+    {
+      enum intr_level old_level;
+      struct work *w;
+      work_func *func;
+      void *aux;
+      uint64_t latency;
+
+      sema_down (&run_sema);
+      old_level = spinlock_acquire (&workqueue_lock);
+      w = list_entry (list_pop_front (&run_list), struct work, elem);
+      w->pending = false;
+      latency = rdtsc () - w->queued;
+      total_latency += latency;
+      if (latency > max_latency)
+        max_latency = latency;
+      run_cnt++;
+      func = w->func;
+      aux = w->aux;
+      spinlock_release (&workqueue_lock, old_level);
+
+      /* W may be requeued or freed from here on. */
+      func (aux);
+    }
+}
+
+/* Orders struct works by increasing due tick, so that items due
+   at the same tick keep the order in which they were delayed. */
+static bool
+due_less (const struct list_elem *a_, const struct list_elem *b_,
+          void *aux UNUSED) 
+{
+  const struct work *a = list_entry (a_, struct work, elem);
+  const struct work *b = list_entry (b_, struct work, elem);
+
+  return a->due < b->due;
+}
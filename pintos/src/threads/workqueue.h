@@ -0,0 +1,32 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Function run by a work item, given its auxiliary data. */
+typedef void work_func (void *aux);
+
+/* A work item.  Embed one wherever it is convenient, e.g. in the
+   object it works on; it must stay valid until its function
+   starts running, but the function may free it. */
+struct work
+  {
+    struct list_elem elem;      /* Element in a workqueue list. */
+    work_func *func;            /* Function to run. */
+    void *aux;                  /* Argument to FUNC. */
+    bool pending;               /* Queued or delayed, not yet run? */
+    int64_t due;                /* Timer tick to run at, if delayed. */
+    uint64_t queued;            /* rdtsc() when queued to run. */
+  };
+
+void workqueue_init (void);
+void workqueue_start (void);
+void work_init (struct work *, work_func *, void *aux);
+bool work_queue (struct work *);
+bool work_queue_delayed (struct work *, int64_t ticks);
+void workqueue_tick (int64_t now);
+void workqueue_print_stats (void);
+
+#endif /* threads/workqueue.h */
@@ -2,9 +2,13 @@
 #include <stdio.h>
 #include <syscall-nr.h>
 #include <stdbool.h>
+#include <string.h>
 #include "threads/interrupt.h"
+#include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
+#include "userprog/pagedir.h"
 #include "userprog/process.h"
 #include "lib/kernel/list.h"
 #include "devices/input.h"
@@ -17,6 +21,14 @@
 
 static void syscall_handler (struct intr_frame *);
 
+/* Returns true if FILE is open on a directory.  The root is the
+   only directory. */
+static bool
+is_dir_file (struct file *file)
+{
+  return inode_get_inumber (file_get_inode (file)) == ROOT_DIR_SECTOR;
+}
+
 static bool
 cmp_fd (const struct list_elem *a, int fd,
         void *aux UNUSED)
@@ -55,6 +67,55 @@ copy_in (void *dst_, const void *usrc_ ,size_t size)
       thread_exit ();
 }
 
+/* Exits the process unless all SIZE bytes starting at user
+   address UADDR are mapped, and writable if WRITABLE.  Calls
+   that hand a user buffer to the file system or the console
+   check it first, because a fault in there would exit while
+   holding their locks or an open journal operation.  A process
+   has a single thread and its pages are never paged out, so a
+   buffer that passes stays valid for the rest of the call. */
+static void
+check_user_buffer (const void *uaddr, size_t size, bool writable)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  uintptr_t start = (uintptr_t) uaddr;
+  uintptr_t last = start + size - 1;
+  uintptr_t page;
+
+  if (size == 0)
+    return;
+  if (last < start || !is_user_vaddr ((void *) last))
+    exit (-1);
+  for (page = (uintptr_t) pg_round_down (uaddr); page <= last;
+       page += PGSIZE)
+    if (writable
+        ? !pagedir_is_writable (pd, (void *) page)
+        : pagedir_get_page (pd, (void *) page) == NULL)
+      exit (-1);
+}
+
+/* Exits the process unless the whole null-terminated string at
+   user address USTR is mapped, as check_user_buffer() does for a
+   buffer. */
+static void
+check_user_string (const char *ustr)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  const char *p = ustr;
+
+  for (;;)
+    {
+      const char *page_end;
+
+      if (!is_user_vaddr (p) || pagedir_get_page (pd, p) == NULL)
+        exit (-1);
+      page_end = (const char *) pg_round_down (p) + PGSIZE;
+      for (; p < page_end; p++)
+        if (*p == '\0')
+          return;
+    }
+}
+
 static void
 syscall_handler (struct intr_frame *f) 
 {
@@ -63,6 +124,7 @@ syscall_handler (struct intr_frame *f)
   unsigned c; 
   
   copy_in (&c, f->esp, sizeof c);
+  TRACE (TRACE_SYSCALL_ENTER, thread_current ()->tid, c, 0);
 
   switch (c)
     {
@@ -141,12 +203,55 @@ syscall_handler (struct intr_frame *f)
         copy_in (argv, (uint32_t *) f->esp + 1, sizeof *argv * argc);
         close (argv[0]);
         break;
+
+      case SYS_ISDIR:
+        argc = 1;
+        copy_in (argv, (uint32_t *) f->esp + 1, sizeof *argv * argc);
+        f->eax = isdir (argv[0]);
+        break;
+
+      case SYS_INUMBER:
+        argc = 1;
+        copy_in (argv, (uint32_t *) f->esp + 1, sizeof *argv * argc);
+        f->eax = inumber (argv[0]);
+        break;
+
+      case SYS_GETDENTS:
+        argc = 3;
+        copy_in (argv, (uint32_t *) f->esp + 1, sizeof *argv * argc);
+        f->eax = getdents (argv[0], (struct dirent *)argv[1],
+                           (unsigned)argv[2]);
+        break;
+
+      case SYS_FALLOCATE:
+        argc = 3;
+        copy_in (argv, (uint32_t *) f->esp + 1, sizeof *argv * argc);
+        f->eax = fallocate (argv[0], (unsigned)argv[1], (unsigned)argv[2]);
+        break;
+
+      case SYS_GETRUSAGE:
+        argc = 1;
+        copy_in (argv, (uint32_t *) f->esp + 1, sizeof *argv * argc);
+        getrusage ((struct rusage *)argv[0]);
+        break;
+
+      case SYS_SCHED_SETDEADLINE:
+        argc = 3;
+        copy_in (argv, (uint32_t *) f->esp + 1, sizeof *argv * argc);
+        f->eax = sched_setdeadline ((unsigned)argv[0], (unsigned)argv[1],
+                                    (unsigned)argv[2]);
+        break;
+
+      case SYS_SCHED_YIELD:
+        f->eax = sched_yield ();
+        break;
     
       default:
         printf ("ERROR: syscall not found\n");
         thread_exit ();
         break;
     }
+  TRACE (TRACE_SYSCALL_EXIT, thread_current ()->tid, c, 0);
 }
 
 void
@@ -168,6 +273,7 @@ exit (int status)
 pid_t
 exec (const char *cmd_line)
 { 
+  check_user_string (cmd_line);
   return process_execute (cmd_line);
 }
 
@@ -182,6 +288,7 @@ create (const char *file, unsigned initial_size)
 {
   if (file == NULL)
     exit (-1);
+  check_user_string (file);
   return filesys_create (file, initial_size);
 }
 
@@ -190,6 +297,7 @@ remove (const char *file)
 {
   if (file == NULL)			/* need to account for removing */
     return false;			/* opened files. */
+  check_user_string (file);
   return filesys_remove (file);
 }
 
@@ -198,6 +306,7 @@ open (const char *file)
 {
   if (file == NULL)
     return -1;
+  check_user_string (file);
   struct pair *p = malloc (4);
   p->file = filesys_open (file);
     if (p->file == NULL)
@@ -229,15 +338,14 @@ read (int fd, void *buffer, unsigned size)
   if (fd == 0)
     return input_getc ();
 
-  if (!is_user_vaddr (buffer))
-    exit (-1);
+  check_user_buffer (buffer, size, true);
     
   struct thread *t = thread_current ();
   struct list_elem *e = list_find (&t->file_list, &cmp_fd, fd, NULL);
   if (e == NULL)
     return -1;
   struct pair *p = list_entry (e, struct pair, elem);
-  if (p == NULL)
+  if (p == NULL || is_dir_file (p->file))
     return -1;
   return file_read (p->file, buffer, size);
 }
@@ -247,6 +355,7 @@ write (int fd, const void *buffer, unsigned size)
 {
   if (fd == 0 || !is_user_vaddr (buffer))
     return -1;
+  check_user_buffer (buffer, size, false);
   /*need to segment buffer if it is too big */
   if (fd == 1)
     {
@@ -258,7 +367,7 @@ write (int fd, const void *buffer, unsigned size)
   if (e == NULL)
 	return;
   struct pair *p = list_entry (e, struct pair, elem);
-  if (p == NULL)
+  if (p == NULL || is_dir_file (p->file))
     return -1;
   return file_write (p->file, buffer, size);
 }
@@ -311,3 +420,126 @@ close (int fd)
   
   return;
 }
+
+bool
+isdir (int fd)
+{
+  struct thread *t = thread_current ();
+  struct list_elem *e = list_find (&t->file_list, &cmp_fd, fd, NULL);
+  if (e == NULL)
+    return false;
+  struct pair *p = list_entry (e, struct pair, elem);
+  return is_dir_file (p->file);
+}
+
+int
+inumber (int fd)
+{
+  struct thread *t = thread_current ();
+  struct list_elem *e = list_find (&t->file_list, &cmp_fd, fd, NULL);
+  if (e == NULL)
+    return -1;
+  struct pair *p = list_entry (e, struct pair, elem);
+  return inode_get_inumber (file_get_inode (p->file));
+}
+
+/* Stores as many entries of directory FD as fit in the SIZE
+   bytes of BUFFER, up to a page's worth, starting where the
+   previous call on FD left off, which is kept as FD's file
+   position.  Returns the number of entries stored, 0 at the end
+   of the directory, or -1 if FD is not an open directory or
+   memory is short.  The entries are gathered in a kernel page and
+   copied out only after the directory is closed again. */
+int
+getdents (int fd, struct dirent *buffer, unsigned size)
+{
+  size_t cnt = size / sizeof *buffer;
+  struct dirent *entries;
+  struct dir *dir;
+  size_t stored;
+
+  check_user_buffer (buffer, cnt * sizeof *buffer, true);
+  if (cnt > PGSIZE / sizeof *entries)
+    cnt = PGSIZE / sizeof *entries;
+
+  struct thread *t = thread_current ();
+  struct list_elem *e = list_find (&t->file_list, &cmp_fd, fd, NULL);
+  if (e == NULL)
+    return -1;
+  struct pair *p = list_entry (e, struct pair, elem);
+  if (!is_dir_file (p->file))
+    return -1;
+
+  entries = palloc_get_page (0);
+  if (entries == NULL)
+    return -1;
+  dir = dir_open (inode_reopen (file_get_inode (p->file)));
+  if (dir == NULL)
+    {
+      palloc_free_page (entries);
+      return -1;
+    }
+  dir_seek (dir, file_tell (p->file));
+  stored = dir_getdents (dir, entries, cnt);
+  file_seek (p->file, dir_tell (dir));
+  dir_close (dir);
+
+  memcpy (buffer, entries, stored * sizeof *entries);
+  palloc_free_page (entries);
+  return stored;
+}
+
+/* Reserves disk space for LENGTH bytes of file FD starting at
+   OFFSET, extending the file to cover them.  The reserved bytes
+   read as zeros until written.  Returns true if successful,
+   false on failure. */
+bool
+fallocate (int fd, unsigned offset, unsigned length)
+{
+  if (fd == 0 || fd == 1)
+    return false;
+  struct thread *t = thread_current ();
+  struct list_elem *e = list_find (&t->file_list, &cmp_fd, fd, NULL);
+  if (e == NULL)
+    return false;
+  struct pair *p = list_entry (e, struct pair, elem);
+  if (is_dir_file (p->file))
+    return false;
+  return file_fallocate (p->file, (off_t) offset, (off_t) length);
+}
+
+/* Stores the running process's CPU accounting into *USAGE.  The
+   snapshot is taken into a kernel buffer first, since writing
+   user memory may fault. */
+void
+getrusage (struct rusage *usage)
+{
+  struct rusage copy;
+
+  if (!is_user_vaddr (usage)
+      || !is_user_vaddr ((uint8_t *) usage + sizeof *usage - 1))
+    exit (-1);
+  thread_get_rusage (&copy);
+  *usage = copy;
+}
+
+/* Puts the running process in the EDF scheduling class, or takes
+   it out if RUNTIME is 0.  Times are in timer ticks.  Returns
+   false if admission control rejects the request. */
+bool
+sched_setdeadline (unsigned runtime, unsigned period, unsigned deadline)
+{
+  return thread_set_edf (runtime, period, deadline);
+}
+
+/* Yields the CPU.  For an EDF process, this ends the current job
+   and returns false if the job missed its deadline.  Otherwise
+   returns true. */
+bool
+sched_yield (void)
+{
+  if (thread_current ()->edf)
+    return thread_edf_yield ();
+  thread_yield ();
+  return true;
+}
@@ -19,6 +19,13 @@ int write (int fd, const void *buffer, unsigned size);
 void seek (int fd, unsigned position);
 unsigned tell (int fd);
 void close (int fd);
+bool isdir (int fd);
+int inumber (int fd);
+int getdents (int fd, struct dirent *buffer, unsigned size);
+bool fallocate (int fd, unsigned offset, unsigned length);
+void getrusage (struct rusage *usage);
+bool sched_setdeadline (unsigned runtime, unsigned period, unsigned deadline);
+bool sched_yield (void);
 
 
 #endif /* userprog/syscall.h */